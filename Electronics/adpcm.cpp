@@ -0,0 +1,93 @@
+#include "adpcm.h"
+#include <string.h>
+
+static const int16_t stepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+static const int8_t indexTable[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static uint8_t encodeSample(AdpcmEncoder *enc, int32_t sample) {
+    int32_t step = stepTable[enc->index];
+    int32_t diff = sample - enc->predictor;
+    uint8_t code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+
+    // Successive approximation of diff / step in three bits, tracking the
+    // exact delta the decoder will reconstruct
+    int32_t delta = step >> 3;
+    if (diff >= step) { code |= 4; diff -= step; delta += step; }
+    step >>= 1;
+    if (diff >= step) { code |= 2; diff -= step; delta += step; }
+    step >>= 1;
+    if (diff >= step) { code |= 1; delta += step; }
+
+    enc->predictor += (code & 8) ? -delta : delta;
+    if (enc->predictor > 32767) enc->predictor = 32767;
+    if (enc->predictor < -32768) enc->predictor = -32768;
+
+    enc->index += indexTable[code];
+    if (enc->index < 0) enc->index = 0;
+    if (enc->index > 88) enc->index = 88;
+    return code;
+}
+
+static void startBlock(AdpcmEncoder *enc, int16_t first) {
+    // The header sample is stored verbatim and seeds the predictor
+    enc->predictor = first;
+    enc->block[0] = (uint8_t)first;
+    enc->block[1] = (uint8_t)((uint16_t)first >> 8);
+    enc->block[2] = (uint8_t)enc->index;
+    enc->block[3] = 0;
+    memset(&enc->block[4], 0, ADPCM_BLOCK_BYTES - 4);
+}
+
+void adpcmInit(AdpcmEncoder *enc) {
+    enc->predictor = 0;
+    enc->index = 0;
+    enc->fill = 0;
+}
+
+size_t adpcmEncode(AdpcmEncoder *enc, const int16_t *samples, size_t count,
+                   uint8_t *out, size_t outCapacity) {
+    size_t written = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (enc->fill == 0) {
+            startBlock(enc, samples[i]);
+        } else {
+            uint8_t code = encodeSample(enc, samples[i]);
+            size_t pos = 4 + (enc->fill - 1) / 2;
+            enc->block[pos] |= ((enc->fill - 1) & 1) ? (uint8_t)(code << 4) : code;
+        }
+
+        if (++enc->fill == ADPCM_SAMPLES_PER_BLOCK) {
+            if (written + ADPCM_BLOCK_BYTES <= outCapacity) {
+                memcpy(&out[written], enc->block, ADPCM_BLOCK_BYTES);
+                written += ADPCM_BLOCK_BYTES;
+            }
+            enc->fill = 0;
+        }
+    }
+    return written;
+}
+
+size_t adpcmFlush(AdpcmEncoder *enc, uint8_t *out, size_t outCapacity) {
+    if (enc->fill == 0 || outCapacity < ADPCM_BLOCK_BYTES) return 0;
+
+    // Unused nibbles are already zero; decoders stop at the fact chunk length
+    memcpy(out, enc->block, ADPCM_BLOCK_BYTES);
+    enc->fill = 0;
+    return ADPCM_BLOCK_BYTES;
+}
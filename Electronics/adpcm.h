@@ -0,0 +1,29 @@
+// Streaming IMA-ADPCM encoder (WAV format tag 0x0011, mono)
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Each block is a 4-byte header (first sample + step index) followed by
+// 4-bit codes, low nibble first, so a 256-byte block holds 505 samples.
+#define ADPCM_BLOCK_BYTES        256
+#define ADPCM_SAMPLES_PER_BLOCK  ((ADPCM_BLOCK_BYTES - 4) * 2 + 1)
+
+struct AdpcmEncoder {
+    int32_t predictor;
+    int32_t index;
+    size_t fill;                      // Samples in the current block
+    uint8_t block[ADPCM_BLOCK_BYTES];
+};
+
+void adpcmInit(AdpcmEncoder *enc);
+
+// Encode count samples. Every block completed along the way is copied to
+// out (room for outCapacity bytes); returns the bytes written. Samples past
+// the last full block stay buffered in the encoder. Worst case output is
+// (count / ADPCM_SAMPLES_PER_BLOCK + 1) blocks.
+size_t adpcmEncode(AdpcmEncoder *enc, const int16_t *samples, size_t count,
+                   uint8_t *out, size_t outCapacity);
+
+// Pad and emit the partial block, if any. Returns bytes written (0 or one block).
+size_t adpcmFlush(AdpcmEncoder *enc, uint8_t *out, size_t outCapacity);
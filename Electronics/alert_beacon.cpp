@@ -0,0 +1,184 @@
+#include "alert_beacon.h"
+#include "alert_frame.h"
+#include "esp_timer.h"
+
+#define ADV_MAX              31
+#define ADV_TYPE_FLAGS       0x01
+#define ADV_TYPE_UUID128     0x07     // Complete list of 128-bit service UUIDs
+#define ADV_TYPE_NAME_SHORT  0x08
+#define ADV_TYPE_NAME        0x09
+#define ADV_TYPE_CONN_RANGE  0x12
+#define ADV_TYPE_MANUFACTURER 0xFF
+#define ADV_FLAGS_GENERAL    0x06     // General discoverable, BR/EDR not supported
+
+struct AdvPayload {
+    uint8_t data[ADV_MAX];
+    uint8_t len;
+};
+
+static BLEAdvertising *advertiser = nullptr;
+
+// Built once in alertBeaconBegin(); only the beacon's manufacturer data changes
+static AdvPayload normalAdv, normalScan;
+static AdvPayload beaconAdv, beaconScan;
+static uint8_t beaconFrameAt = 0;
+
+// Controller task only
+static bool active = false;            // Burst running, paused while connected
+static int64_t burstStartUs = 0;
+static AlertBeaconStats stats = {};
+
+static uint8_t *addField(AdvPayload &p, uint8_t type, uint8_t len) {
+    p.data[p.len] = len + 1;
+    p.data[p.len + 1] = type;
+    uint8_t *value = &p.data[p.len + 2];
+    p.len += len + 2;
+    return value;
+}
+
+static void addName(AdvPayload &p, const char *name) {
+    size_t len = strlen(name);
+    size_t room = ADV_MAX - p.len - 2;
+    uint8_t type = ADV_TYPE_NAME;
+    if (len > room) {
+        len = room;
+        type = ADV_TYPE_NAME_SHORT;
+    }
+    memcpy(addField(p, type, len), name, len);
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// "6e400001-b5a3-..." is written most significant byte first; the air is little-endian
+static void addUuid128(AdvPayload &p, const char *uuid) {
+    uint8_t *out = addField(p, ADV_TYPE_UUID128, 16);
+    int at = 15;
+    for (const char *c = uuid; *c && at >= 0; c++) {
+        int hi = hexDigit(c[0]);
+        if (hi < 0) continue;
+        int lo = hexDigit(c[1]);
+        if (lo < 0) break;
+        out[at--] = hi << 4 | lo;
+        c++;
+    }
+}
+
+static void addFlags(AdvPayload &p) {
+    addField(p, ADV_TYPE_FLAGS, 1)[0] = ADV_FLAGS_GENERAL;
+}
+
+static void apply(const AdvPayload &adv, const AdvPayload &scan, uint16_t interval_min, uint16_t interval_max,
+                  bool restart) {
+    esp_ble_gap_config_adv_data_raw((uint8_t *)adv.data, adv.len);
+    esp_ble_gap_config_scan_rsp_data_raw((uint8_t *)scan.data, scan.len);
+    advertiser->setMinInterval(interval_min);
+    advertiser->setMaxInterval(interval_max);
+    if (restart) {
+        // The interval only takes effect on a fresh start
+        advertiser->stop();
+        advertiser->start();
+    }
+}
+
+static void applyNormal(bool restart) {
+    apply(normalAdv, normalScan, BEACON_NORMAL_MIN, BEACON_NORMAL_MAX, restart);
+}
+
+static void applyBeacon() {
+    apply(beaconAdv, beaconScan, BEACON_INTERVAL, BEACON_INTERVAL, true);
+}
+
+void alertBeaconBegin(BLEAdvertising *advertising, const char *name, const char *serviceUuid) {
+    advertiser = advertising;
+
+    normalAdv.len = 0;
+    addFlags(normalAdv);
+    addUuid128(normalAdv, serviceUuid);
+
+    normalScan.len = 0;
+    addName(normalScan, name);
+    uint8_t *range = addField(normalScan, ADV_TYPE_CONN_RANGE, 4);
+    range[0] = BEACON_CONN_MIN_INTERVAL & 0xFF;
+    range[1] = BEACON_CONN_MIN_INTERVAL >> 8;
+    range[2] = BEACON_CONN_MAX_INTERVAL & 0xFF;
+    range[3] = BEACON_CONN_MAX_INTERVAL >> 8;
+
+    // The alert takes the advertisement; the scan response keeps the device
+    // findable by service and name
+    beaconAdv.len = 0;
+    addFlags(beaconAdv);
+    uint8_t *manufacturer = addField(beaconAdv, ADV_TYPE_MANUFACTURER, 2 + ALERT_BEACON_SIZE);
+    manufacturer[0] = BEACON_COMPANY_ID & 0xFF;
+    manufacturer[1] = BEACON_COMPANY_ID >> 8;
+    beaconFrameAt = manufacturer + 2 - beaconAdv.data;
+
+    beaconScan.len = 0;
+    addUuid128(beaconScan, serviceUuid);
+    addName(beaconScan, name);
+
+    // Custom data once through BLEAdvertising, so neither its start() nor the
+    // server's restart on disconnect rebuilds the payload over the raw one
+    BLEAdvertisementData adv, scan;
+    adv.addData(std::string((const char *)normalAdv.data, normalAdv.len));
+    scan.addData(std::string((const char *)normalScan.data, normalScan.len));
+    advertising->setAdvertisementData(adv);
+    advertising->setScanResponseData(scan);
+    advertising->setMinInterval(BEACON_NORMAL_MIN);
+    advertising->setMaxInterval(BEACON_NORMAL_MAX);
+}
+
+void alertBeaconStart(const uint8_t *alert, size_t len) {
+    if (advertiser == nullptr || alertBeaconEncode(alert, len, &beaconAdv.data[beaconFrameAt]) == 0) return;
+
+    burstStartUs = esp_timer_get_time();
+    if (active) {
+        // Same interval: new data applies to the running advertisement
+        esp_ble_gap_config_adv_data_raw(beaconAdv.data, beaconAdv.len);
+        stats.updates++;
+        return;
+    }
+    active = true;
+    stats.bursts++;
+    applyBeacon();
+}
+
+void alertBeaconOnConnect() {
+    if (!active) return;
+    // Whatever the server restarts on the next disconnect is the normal
+    // advertisement; stop() also covers a connect that raced applyBeacon()
+    applyNormal(false);
+    advertiser->stop();
+}
+
+void alertBeaconOnDisconnect() {
+    if (active) applyBeacon();
+}
+
+static void endBurst(bool connected) {
+    active = false;
+    // Connected: the normal payload is already in place and nothing advertises
+    if (!connected) applyNormal(true);
+}
+
+void alertBeaconPoll(bool connected, uint32_t pending) {
+    if (!active) return;
+    if (esp_timer_get_time() - burstStartUs >= BEACON_BURST_MS * 1000LL) {
+        stats.timedOut++;
+        endBurst(connected);
+    } else if (pending == 0) {
+        endBurst(connected);
+    }
+}
+
+bool alertBeaconActive() {
+    return active;
+}
+
+AlertBeaconStats alertBeaconStats() {
+    return stats;
+}
@@ -0,0 +1,54 @@
+// Alert beacon - advertise the newest undelivered alert while no central is connected
+#pragma once
+
+#include <Arduino.h>
+#include <BLEDevice.h>
+
+// With nobody connected, sendAlert() switches advertising to a burst on
+// the fastest connectable interval carrying the alert's beacon frame as
+// manufacturer data (alertBeaconEncode(), alert_frame.h). Any phone
+// running the app sees the alert from the scan alone; the one it pairs
+// with still connects to the same advertisement and gets the full frame
+// from the alert log. Anyone scanning can read the position, which is why
+// the burst only runs for undelivered alerts and ends on its own.
+//
+// Legacy advertising throughout: the rest of the stack (BLEAdvertising,
+// the server's restart on disconnect) drives the legacy API and Bluedroid
+// can't mix it with extended advertising sets. Payloads are prebuilt
+// raw, so the alert path doesn't touch the heap.
+#define BEACON_COMPANY_ID       0xFFFF     // Bluetooth SIG ID reserved for testing
+#define BEACON_BURST_MS         60000
+
+// Advertising interval units are 0.625ms
+#define BEACON_INTERVAL         0x20       // 20ms, the connectable minimum
+#define BEACON_NORMAL_MIN       0x20       // BLEAdvertising's defaults, 20ms - 40ms
+#define BEACON_NORMAL_MAX       0x40
+
+// Preferred connection interval in the normal scan response, 7.5ms - 22.5ms
+#define BEACON_CONN_MIN_INTERVAL 0x06
+#define BEACON_CONN_MAX_INTERVAL 0x12
+
+struct AlertBeaconStats {
+    uint32_t bursts;
+    uint32_t updates;                 // Alerts that replaced the payload mid-burst
+    uint32_t timedOut;                // Ended by BEACON_BURST_MS, not delivery
+};
+
+// Build the normal payloads (name, service UUID) and hand them to the
+// advertiser. Call before the first BLEDevice::startAdvertising().
+void alertBeaconBegin(BLEAdvertising *advertising, const char *name, const char *serviceUuid);
+
+// Controller task. Start or refresh the burst with an encoded alert frame;
+// never called while connected.
+void alertBeaconStart(const uint8_t *alert, size_t len);
+
+// Controller task, from the connection events
+void alertBeaconOnConnect();
+void alertBeaconOnDisconnect();
+
+// Every controller pass: ends the burst once nothing is pending or it ran
+// for BEACON_BURST_MS
+void alertBeaconPoll(bool connected, uint32_t pending);
+
+bool alertBeaconActive();
+AlertBeaconStats alertBeaconStats();
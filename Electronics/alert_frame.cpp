@@ -0,0 +1,97 @@
+#include "alert_frame.h"
+#include <string.h>
+
+static inline void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+size_t alertFrameEncode(const AlertFrame &frame, uint8_t *out) {
+    out[0] = (FRAME_VERSION << 4) | FRAME_KIND_ALERT;
+    out[1] = frame.alert_type;
+    put16(&out[2], frame.seq);
+    put32(&out[4], (uint32_t)frame.lat_e7);
+    put32(&out[8], (uint32_t)frame.lng_e7);
+    put32(&out[12], frame.utc);
+    out[16] = frame.hdop_x10;
+    out[17] = frame.sats;
+    put16(&out[18], frame.fix_age_s);
+    out[20] = frame.flags;
+    out[21] = frame.acc_m;
+    put16(&out[22], frameCrc16(out, 22));
+    return ALERT_FRAME_SIZE;
+}
+
+size_t statusFrameEncode(const StatusFrame &frame, uint8_t mask, uint8_t *out) {
+    size_t n = 0;
+    out[n++] = (FRAME_VERSION << 4) | FRAME_KIND_STATUS;
+    out[n++] = mask;
+    if (mask & STATUS_FIELD_MODE) out[n++] = frame.mode;
+    if (mask & STATUS_FIELD_BATTERY) out[n++] = frame.batteryPct;
+    if (mask & STATUS_FIELD_GPS) {
+        out[n++] = frame.gpsFlags;
+        out[n++] = frame.sats;
+    }
+    if (mask & STATUS_FIELD_NOISE) out[n++] = (uint8_t)frame.noiseFloorDb;
+    if (mask & STATUS_FIELD_ALERTS) {
+        put16(&out[n], frame.alertsPending);
+        n += 2;
+    }
+    put16(&out[n], frameCrc16(out, n));
+    return n + 2;
+}
+
+size_t alertBeaconEncode(const uint8_t *alert, size_t len, uint8_t *out) {
+    if (len < ALERT_FRAME_SIZE || alert[0] != ((FRAME_VERSION << 4) | FRAME_KIND_ALERT)) return 0;
+    out[0] = (FRAME_VERSION << 4) | FRAME_KIND_BEACON;
+    memcpy(&out[1], &alert[1], 15);           // Type, sequence, position, UTC
+    out[16] = alert[20];
+    put16(&out[17], frameCrc16(out, 17));
+    return ALERT_BEACON_SIZE;
+}
+
+void alertFrameSetFlags(uint8_t *frame, size_t len, uint8_t flags) {
+    if (len < ALERT_FRAME_SIZE) return;       // Version 1 frames have no flags byte
+    frame[20] |= flags;
+    put16(&frame[22], frameCrc16(frame, 22));
+}
+
+void alertFrameSetSeq(uint8_t *frame, size_t len, uint16_t seq) {
+    if (len < 4) return;
+    put16(&frame[2], seq);
+    put16(&frame[len - 2], frameCrc16(frame, len - 2));
+}
+
+// CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, no reflection
+uint16_t frameCrc16Update(uint16_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+uint16_t frameCrc16(const uint8_t *data, size_t len) {
+    return frameCrc16Update(FRAME_CRC_INIT, data, len);
+}
+
+uint32_t frameUtcSeconds(uint16_t year, uint8_t month, uint8_t day,
+                         uint8_t hour, uint8_t minute, uint8_t second) {
+    // Days from civil (Howard Hinnant), valid for any Gregorian date after 1970
+    int32_t y = (int32_t)year - (month <= 2 ? 1 : 0);
+    int32_t era = y / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int32_t days = era * 146097 + (int32_t)doe - 719468;
+    return (uint32_t)days * 86400UL + hour * 3600UL + minute * 60UL + second;
+}
@@ -0,0 +1,140 @@
+// Fixed-layout binary frames sent over the TX characteristic
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Every frame starts with a version/kind byte whose value is a control
+// character, so the app can tell binary frames from legacy text messages.
+// All multi-byte fields are little-endian; the trailing CRC-16/CCITT-FALSE
+// covers every byte before it. src/lib/alert-frame.ts mirrors this layout.
+#define FRAME_VERSION        2
+#define FRAME_KIND_ALERT     1
+#define FRAME_KIND_RESPONSE  2            // Command responses, see command_protocol.h
+#define FRAME_KIND_STATUS    3
+#define FRAME_KIND_BEACON    4            // Advertised, see alert_beacon.h
+
+#define FRAME_LAT_UNKNOWN    INT32_MIN
+#define FRAME_HDOP_UNKNOWN   0xFF
+#define FRAME_FIX_AGE_UNKNOWN 0xFFFF
+#define FRAME_ACC_UNKNOWN    0
+
+// Alert frame flags
+#define FRAME_FLAG_FIX_CACHED     0x01  // Position is a last-known fix, not a current one
+#define FRAME_FLAG_DEAD_RECKONED  0x02  // ... advanced along its speed and course
+#define FRAME_FLAG_CLOCK_TIME     0x04  // UTC from the (GPS-set) system clock, no current GPS time
+#define FRAME_FLAG_REPLAYED       0x08  // Delivered late from the alert log (alert_log.h)
+#define FRAME_FLAG_FUSED          0x10  // Weak events from several detectors together (trigger_fusion.h)
+
+// Alert frame, version 2 (24 bytes; needs more than the default 23-byte MTU)
+//   0  u8   version << 4 | kind
+//   1  u8   alert type (ALERT_FRAME_*), of the detector that led the alert
+//   2  u16  sequence number
+//   4  i32  latitude  * 1e7  (FRAME_LAT_UNKNOWN when there is no fix)
+//   8  i32  longitude * 1e7
+//  12  u32  UTC seconds since 1970 at the alert (0 when unknown)
+//  16  u8   HDOP * 10 of the fix, saturated (FRAME_HDOP_UNKNOWN when not valid)
+//  17  u8   satellites used by the fix
+//  18  u16  fix age in seconds, saturated (FRAME_FIX_AGE_UNKNOWN without a fix)
+//  20  u8   FRAME_FLAG_* bits
+//  21  u8   horizontal accuracy in metres, rounded up, saturated at 255
+//           (FRAME_ACC_UNKNOWN when the receiver gives no estimate)
+//  22  u16  CRC
+// Version 1 was the same up to byte 17 with the CRC at 18 (20 bytes).
+#define ALERT_FRAME_SIZE     24
+
+enum AlertFrameType : uint8_t {
+    ALERT_FRAME_VOICE = 0,
+    ALERT_FRAME_PIN   = 1,
+    ALERT_FRAME_TEST  = 2,            // Requested with CMD_TEST_ALERT; not an emergency
+    ALERT_FRAME_MOTION = 3            // IMU fall or shake
+};
+
+struct AlertFrame {
+    uint8_t alert_type;
+    uint16_t seq;
+    int32_t lat_e7;
+    int32_t lng_e7;
+    uint32_t utc;
+    uint8_t hdop_x10;
+    uint8_t sats;
+    uint16_t fix_age_s;
+    uint8_t flags;
+    uint8_t acc_m;
+};
+
+// Serialize into out (at least ALERT_FRAME_SIZE bytes); returns bytes written
+size_t alertFrameEncode(const AlertFrame &frame, uint8_t *out);
+
+// Beacon frame: the parts of an alert frame a scanner needs, small enough
+// for manufacturer data in a legacy advertisement
+//   0  u8   version << 4 | FRAME_KIND_BEACON
+//   1  u8   alert type
+//   2  u16  sequence number
+//   4  i32  latitude  * 1e7 (FRAME_LAT_UNKNOWN when there is no fix)
+//   8  i32  longitude * 1e7
+//  12  u32  UTC seconds
+//  16  u8   FRAME_FLAG_* bits
+//  17  u16  CRC
+#define ALERT_BEACON_SIZE    19
+
+// From an encoded version 2 alert frame; 0 if alert isn't one
+size_t alertBeaconEncode(const uint8_t *alert, size_t len, uint8_t *out);
+
+// Status frame: only the fields whose STATUS_FIELD_* bit is set follow the
+// mask, in bit order, so an unchanged field costs nothing.
+//   0  u8   version << 4 | FRAME_KIND_STATUS
+//   1  u8   STATUS_FIELD_* mask; STATUS_FIELD_ALL marks a full keepalive
+//   ..  u8   mode (STATUS_MODE_*), bit 7 set in low power      STATUS_FIELD_MODE
+//   ..  u8   battery percent, STATUS_BATTERY_UNKNOWN if not wired STATUS_FIELD_BATTERY
+//   ..  u8   STATUS_GPS_* flags, u8 satellites of the cached fix STATUS_FIELD_GPS
+//   ..  i8   noise floor, dBFS                                  STATUS_FIELD_NOISE
+//   ..  u16  alerts waiting for an ack                          STATUS_FIELD_ALERTS
+//   n  u16  CRC
+#define STATUS_FIELD_MODE     0x01
+#define STATUS_FIELD_BATTERY  0x02
+#define STATUS_FIELD_GPS      0x04
+#define STATUS_FIELD_NOISE    0x08
+#define STATUS_FIELD_ALERTS   0x10
+#define STATUS_FIELD_ALL      0x1F
+#define STATUS_FRAME_MAX_SIZE 11
+
+#define STATUS_MODE_MONITORING 0
+#define STATUS_MODE_ALERTING   1
+#define STATUS_MODE_RECORDING  2
+#define STATUS_MODE_LOW_POWER  0x80
+
+#define STATUS_BATTERY_UNKNOWN 0xFF
+
+#define STATUS_GPS_FIX_FRESH   0x01   // Current fix
+#define STATUS_GPS_FIX_CACHED  0x02   // Some fix is held, current or not
+#define STATUS_GPS_CLOCK       0x04   // System clock set from GPS
+#define STATUS_GPS_BACKUP      0x08   // Receiver in backup (duty-cycled off)
+
+struct StatusFrame {
+    uint8_t mode;
+    uint8_t batteryPct;
+    uint8_t gpsFlags;
+    uint8_t sats;
+    int8_t noiseFloorDb;
+    uint16_t alertsPending;
+};
+
+// Serialize the fields in mask (at most STATUS_FRAME_MAX_SIZE bytes)
+size_t statusFrameEncode(const StatusFrame &frame, uint8_t mask, uint8_t *out);
+
+uint16_t frameCrc16(const uint8_t *data, size_t len);
+
+// Incremental form for data written in pieces: start from FRAME_CRC_INIT
+#define FRAME_CRC_INIT 0xFFFF
+uint16_t frameCrc16Update(uint16_t crc, const uint8_t *data, size_t len);
+
+// Set flag bits in an encoded alert frame and reseal its CRC
+void alertFrameSetFlags(uint8_t *frame, size_t len, uint8_t flags);
+
+// Replace the sequence number in an encoded alert frame and reseal its CRC
+void alertFrameSetSeq(uint8_t *frame, size_t len, uint16_t seq);
+
+// Seconds since 1970-01-01 for a UTC calendar date and time
+uint32_t frameUtcSeconds(uint16_t year, uint8_t month, uint8_t day,
+                         uint8_t hour, uint8_t minute, uint8_t second);
@@ -0,0 +1,322 @@
+#include "alert_log.h"
+#include "FS.h"
+#include "sd_storage.h"
+#include "ble_tx_queue.h"
+#include "app_config.h"
+
+struct PendingAlert {
+    uint8_t frame[ALERT_LOG_PAYLOAD];
+    uint8_t len;
+    uint16_t seq;
+    uint8_t attempts;                 // This connection, handed to the stack
+    bool queued;                      // With the TX task, outcome not back yet
+    bool tried;                       // An outcome came back this connection
+    bool late;                        // Logged offline, loaded from SD or already sent once
+    uint32_t createdMs;
+    uint32_t sentMs;
+};
+
+static PendingAlert pending[ALERT_LOG_DEPTH];
+static uint16_t head = 0;             // Oldest
+static uint16_t count = 0;
+static uint16_t nextSeq = 0;
+static uint16_t bootSeq = 0;          // First number handed out this boot
+static uint16_t seqLimit = 0;         // First number not reserved in NVS
+static bool useSd = false;
+static bool attached = false;
+static bool wasConnected = false;
+static uint32_t fileRecords = 0;
+static AlertLogStats stats = {};
+
+static inline void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Wrap-safe: true when a is later than b
+static inline bool seqAfter(uint16_t a, uint16_t b) {
+    return (int16_t)(a - b) > 0;
+}
+
+static PendingAlert &at(uint16_t i) {
+    return pending[(head + i) % ALERT_LOG_DEPTH];
+}
+
+static void push(const uint8_t *frame, uint8_t len, uint16_t seq, bool late) {
+    if (count == ALERT_LOG_DEPTH) {
+        head = (head + 1) % ALERT_LOG_DEPTH;
+        count--;
+        stats.overflowed++;
+    }
+    PendingAlert &p = at(count++);
+    memcpy(p.frame, frame, len);
+    p.len = len;
+    p.seq = seq;
+    p.attempts = 0;
+    p.queued = false;
+    p.tried = false;
+    p.late = late;
+    p.createdMs = millis();
+    p.sentMs = 0;
+}
+
+// Drop everything up to and including seq; returns how many went
+static uint16_t popThrough(uint16_t seq) {
+    uint16_t popped = 0;
+    while (count > 0 && !seqAfter(at(0).seq, seq)) {
+        head = (head + 1) % ALERT_LOG_DEPTH;
+        count--;
+        popped++;
+    }
+    return popped;
+}
+
+static PendingAlert *find(uint16_t seq) {
+    for (uint16_t i = 0; i < count; i++) {
+        if (at(i).seq == seq) return &at(i);
+    }
+    return nullptr;
+}
+
+// Drop the one alert with seq, keeping the rest in order; false if none
+static bool removeSeq(uint16_t seq) {
+    for (uint16_t i = 0; i < count; i++) {
+        if (at(i).seq != seq) continue;
+        for (uint16_t j = i; j + 1 < count; j++) {
+            at(j) = at(j + 1);
+        }
+        count--;
+        return true;
+    }
+    return false;
+}
+
+static void encodeRecord(uint8_t *rec, uint8_t type, uint16_t seq, const uint8_t *payload, uint8_t len) {
+    memset(rec, 0, ALERT_LOG_RECORD_SIZE);
+    rec[0] = type;
+    rec[1] = len;
+    put16(&rec[2], seq);
+    if (len > 0) memcpy(&rec[4], payload, len);
+    put16(&rec[ALERT_LOG_RECORD_SIZE - 2], frameCrc16(rec, ALERT_LOG_RECORD_SIZE - 2));
+}
+
+static bool recordValid(const uint8_t *rec) {
+    return rec[1] <= ALERT_LOG_PAYLOAD &&
+           (rec[0] == ALERT_LOG_REC_ALERT || rec[0] == ALERT_LOG_REC_DELIVERED || rec[0] == ALERT_LOG_REC_ACK) &&
+           get16(&rec[ALERT_LOG_RECORD_SIZE - 2]) == frameCrc16(rec, ALERT_LOG_RECORD_SIZE - 2);
+}
+
+// Open, write, close: an alert is on the card before anyone is told about it
+static void appendRecord(uint8_t type, uint16_t seq, const uint8_t *payload, uint8_t len) {
+    if (!useSd) return;
+
+    uint8_t rec[ALERT_LOG_RECORD_SIZE];
+    encodeRecord(rec, type, seq, payload, len);
+    File f = sdStorage().open(ALERT_LOG_PATH, FILE_APPEND);
+    if (!f) return;
+    f.write(rec, sizeof(rec));
+    f.close();
+    fileRecords++;
+}
+
+// Replace the log with the sequence high-water mark plus what is pending
+static void compact() {
+    if (!useSd) return;
+
+    File f = sdStorage().open(ALERT_LOG_TMP_PATH, FILE_WRITE);
+    if (!f) return;
+    uint8_t rec[ALERT_LOG_RECORD_SIZE];
+    encodeRecord(rec, ALERT_LOG_REC_ACK, (uint16_t)(nextSeq - 1), NULL, 0);
+    bool ok = f.write(rec, sizeof(rec)) == sizeof(rec);
+    for (uint16_t i = 0; i < count && ok; i++) {
+        encodeRecord(rec, ALERT_LOG_REC_ALERT, at(i).seq, at(i).frame, at(i).len);
+        ok = f.write(rec, sizeof(rec)) == sizeof(rec);
+    }
+    f.close();
+    if (!ok) {
+        sdStorage().remove(ALERT_LOG_TMP_PATH);
+        return;
+    }
+    sdStorage().remove(ALERT_LOG_PATH);
+    sdStorage().rename(ALERT_LOG_TMP_PATH, ALERT_LOG_PATH);
+    fileRecords = 1 + count;
+}
+
+static void reserveSeqs() {
+    seqLimit = (uint16_t)(nextSeq + ALERT_LOG_SEQ_BLOCK);
+    appConfigStoreSeqLimit(seqLimit);
+}
+
+void alertLogBegin() {
+    head = 0;
+    count = 0;
+    appConfigLoadSeqLimit(nextSeq);
+    bootSeq = nextSeq;
+    reserveSeqs();
+}
+
+void alertLogAttach(bool sdReady) {
+    if (attached) return;
+    attached = true;
+    useSd = sdReady;
+    if (!useSd) return;
+
+    // Raised since boot, before the file was read
+    static PendingAlert early[ALERT_LOG_DEPTH];
+    uint16_t earlyCount = count;
+    for (uint16_t i = 0; i < earlyCount; i++) {
+        early[i] = at(i);
+    }
+    head = 0;
+    count = 0;
+
+    // A compaction interrupted between remove and rename
+    if (!sdStorage().exists(ALERT_LOG_PATH) && sdStorage().exists(ALERT_LOG_TMP_PATH)) {
+        sdStorage().rename(ALERT_LOG_TMP_PATH, ALERT_LOG_PATH);
+    }
+
+    File f = sdStorage().open(ALERT_LOG_PATH, FILE_READ);
+    bool haveSeq = false;
+    uint16_t lastSeq = 0;
+    if (f) {
+        uint8_t rec[ALERT_LOG_RECORD_SIZE];
+        while (f.read(rec, sizeof(rec)) == sizeof(rec)) {
+            if (!recordValid(rec)) {
+                stats.badRecords++;
+                continue;
+            }
+            uint16_t seq = get16(&rec[2]);
+            if (rec[0] == ALERT_LOG_REC_ALERT) {
+                push(&rec[4], rec[1], seq, true);
+            } else if (rec[0] == ALERT_LOG_REC_DELIVERED) {
+                removeSeq(seq);
+            } else {
+                popThrough(seq);
+            }
+            if (!haveSeq || seqAfter(seq, lastSeq)) lastSeq = seq;
+            haveSeq = true;
+        }
+        f.close();
+    }
+
+    // The file reaching into this boot's numbers means it predates the NVS
+    // reservation (or NVS was erased): move past it. An early alert the
+    // stack may already have delivered keeps its number; the app holds it
+    // under that one.
+    bool overlap = haveSeq && !seqAfter(bootSeq, lastSeq);
+    if (overlap && !seqAfter(nextSeq, lastSeq)) {
+        nextSeq = (uint16_t)(lastSeq + 1);
+        reserveSeqs();
+    }
+    for (uint16_t i = 0; i < earlyCount; i++) {
+        PendingAlert &e = early[i];
+        if (overlap && e.attempts == 0 && !e.queued && !e.tried) {
+            e.seq = nextSeq++;
+            alertFrameSetSeq(e.frame, e.len, e.seq);
+        }
+        push(e.frame, e.len, e.seq, e.late);
+        PendingAlert &p = at(count - 1);
+        p.attempts = e.attempts;
+        p.queued = e.queued;
+        p.tried = e.tried;
+        p.sentMs = e.sentMs;
+        p.createdMs = e.createdMs;
+    }
+    compact();
+}
+
+uint16_t alertLogTakeSeq() {
+    return nextSeq++;
+}
+
+bool alertLogAppend(const uint8_t *frame, size_t len, bool connected) {
+    if (len > ALERT_LOG_PAYLOAD) return false;
+
+    uint16_t seq = get16(&frame[2]);
+    push(frame, (uint8_t)len, seq, !connected);
+    stats.logged++;
+    alertLogPoll(connected);
+    appendRecord(ALERT_LOG_REC_ALERT, seq, frame, (uint8_t)len);
+    return true;
+}
+
+void alertLogAck(uint16_t seq) {
+    if (!removeSeq(seq)) return;
+
+    stats.acked++;
+    appendRecord(ALERT_LOG_REC_DELIVERED, seq, NULL, 0);
+    if (count == 0 && fileRecords >= ALERT_LOG_COMPACT_RECORDS) {
+        compact();
+    }
+}
+
+// Outcomes from the TX task; acked or dropped alerts are simply not found
+static void takeTxResults(uint32_t now) {
+    BleTxAlertResult result;
+    while (bleTxTakeAlertResult(result)) {
+        PendingAlert *p = find(result.tag);
+        if (p == nullptr || !p->queued) continue;
+        p->queued = false;
+        p->tried = true;
+        p->sentMs = now;
+        if (result.sent) {
+            p->attempts++;
+            stats.sent++;
+        } else {
+            stats.notSent++;
+        }
+    }
+}
+
+void alertLogPoll(bool connected) {
+    uint32_t now = millis();
+    takeTxResults(now);
+    if (!seqAfter(seqLimit, (uint16_t)(nextSeq + ALERT_LOG_SEQ_BLOCK / 2))) reserveSeqs();
+
+    if (!connected) {
+        if (wasConnected) {
+            for (uint16_t i = 0; i < count; i++) {
+                at(i).attempts = 0;
+                at(i).queued = false;
+                at(i).tried = false;
+            }
+        }
+        wasConnected = false;
+        return;
+    }
+    wasConnected = true;
+
+    // Alerts out of attempts wait for the next connection without holding
+    // a window slot; queued ones are on the air and keep theirs
+    uint16_t window = 0;
+    for (uint16_t i = 0; i < count && window < ALERT_LOG_WINDOW; i++) {
+        PendingAlert &p = at(i);
+        if (p.attempts >= ALERT_LOG_MAX_ATTEMPTS) continue;
+        window++;
+        if (p.queued) continue;
+        if (p.tried && now - p.sentMs < ALERT_LOG_RETRY_MS) continue;
+
+        // Anything but a prompt first send is marked, so the app can tell
+        // a late delivery from a current emergency
+        uint8_t frame[ALERT_LOG_PAYLOAD];
+        memcpy(frame, p.frame, p.len);
+        if (p.late || now - p.createdMs >= ALERT_LOG_RETRY_MS) {
+            alertFrameSetFlags(frame, p.len, FRAME_FLAG_REPLAYED);
+        }
+        if (!bleTxEnqueueAlert(frame, p.len, p.seq)) break;
+
+        p.queued = true;
+        p.late = true;
+    }
+}
+
+AlertLogStats alertLogStats() {
+    AlertLogStats s = stats;
+    s.pending = count;
+    s.nextSeq = nextSeq;
+    return s;
+}
@@ -0,0 +1,85 @@
+// Store-and-forward alert log: every alert is kept until the app acks it
+#pragma once
+
+#include <Arduino.h>
+#include "alert_frame.h"
+
+// Append-only file of fixed-size records, each with its own CRC, so a torn
+// write at power loss costs at most the record being written:
+//   0  u8   ALERT_LOG_REC_ALERT / _DELIVERED / _ACK
+//   1  u8   payload length
+//   2  u16  sequence (the alert's, or the highest one acked)
+//   4  ...  alert frame, zero padded to ALERT_LOG_PAYLOAD
+//  30  u16  CRC-16/CCITT-FALSE of bytes 0..29
+// At begin, and once the file grows past ALERT_LOG_COMPACT_RECORDS with
+// nothing pending, it is rewritten as one ack record plus the pending
+// alerts (write to ALERT_LOG_TMP_PATH, then rename). A delivered record
+// removes the one alert with its sequence; the ack record compaction
+// writes applies to every alert before it in the file.
+#define ALERT_LOG_PATH            "/alerts.log"
+#define ALERT_LOG_TMP_PATH        "/alerts.tmp"
+#define ALERT_LOG_RECORD_SIZE     32
+#define ALERT_LOG_PAYLOAD         26
+#define ALERT_LOG_REC_ALERT       'A'
+#define ALERT_LOG_REC_DELIVERED   'D'
+#define ALERT_LOG_REC_ACK         'K'
+#define ALERT_LOG_COMPACT_RECORDS 256
+
+// Unacked alerts kept, in RAM and (with SD) in the file. Past this the
+// oldest is dropped. Without SD the RAM copy is lost on reset.
+#define ALERT_LOG_DEPTH           32
+
+// Sequence numbers are reserved ALERT_LOG_SEQ_BLOCK at a time in NVS
+// (appConfigStoreSeqLimit()) and each boot starts past the last
+// reservation, so a number handed out before SD mounts - or without SD -
+// never repeats one from an earlier boot. The reservation is topped up
+// from alertLogPoll() once half of it is used, never on the alert path.
+#define ALERT_LOG_SEQ_BLOCK       64
+
+// Replay pacing: only the oldest ALERT_LOG_WINDOW pending alerts with
+// attempts left are on the air at once; each is resent after ALERT_LOG_RETRY_MS without an ack,
+// up to ALERT_LOG_MAX_ATTEMPTS per connection. Only a notify the TX task
+// handed to the stack is an attempt; one it couldn't send (CCCD not yet
+// enabled, say) is retried on the same timer without using one up.
+#define ALERT_LOG_WINDOW          4
+#define ALERT_LOG_RETRY_MS        3000
+#define ALERT_LOG_MAX_ATTEMPTS    5
+
+struct AlertLogStats {
+    uint16_t pending;
+    uint16_t nextSeq;
+    uint32_t logged;
+    uint32_t sent;                    // Handed to the stack, including resends
+    uint32_t notSent;                 // Notifies the TX task couldn't send
+    uint32_t acked;
+    uint32_t overflowed;              // Oldest dropped past ALERT_LOG_DEPTH
+    uint32_t badRecords;              // Torn or corrupt records skipped at begin
+};
+
+// RAM only, usable at once so alerts are kept from the moment the button
+// is armed. alertLogAttach() later loads the pending alerts from SD (if
+// sdReady) ahead of those raised since boot, which keep their numbers, and
+// compacts the log. Only when the file already holds those numbers (a log
+// from before the NVS reservation) are the early alerts not yet handed to
+// the stack renumbered past it. All other calls are controller-task only.
+void alertLogBegin();
+void alertLogAttach(bool sdReady);
+
+// Sequence number for the next alert; sequences survive resets with SD
+uint16_t alertLogTakeSeq();
+
+// Keep an encoded alert frame until it is acked. When connected it is
+// queued for TX first and written to SD after, so the card stays out of
+// the alert latency path.
+bool alertLogAppend(const uint8_t *frame, size_t len, bool connected);
+
+// The alert with this seq has reached the app. Acks are per alert: one
+// that arrived doesn't vouch for an earlier one that didn't.
+void alertLogAck(uint16_t seq);
+
+// Send or resend what the window allows. Call on every controller pass; a
+// false connected resets the window so the
+// next connection replays from the oldest pending alert.
+void alertLogPoll(bool connected);
+
+AlertLogStats alertLogStats();
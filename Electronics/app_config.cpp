@@ -0,0 +1,158 @@
+#include "app_config.h"
+#include <Preferences.h>
+
+struct ConfigRecordHeader {
+    uint16_t schema;
+    uint16_t size;
+};
+
+static portMUX_TYPE configLock = portMUX_INITIALIZER_UNLOCKED;
+static AppConfig current = APP_CONFIG_DEFAULTS;
+static AppConfigHook applyHook = NULL;
+
+static void apply(const AppConfig &config) {
+    portENTER_CRITICAL(&configLock);
+    current = config;
+    portEXIT_CRITICAL(&configLock);
+    audioLevelSetConfig(config.levels);
+    if (applyHook != NULL) applyHook(config);
+}
+
+static bool load(AppConfig &config) {
+    Preferences prefs;
+    if (!prefs.begin(APP_CONFIG_NAMESPACE, true)) return false;
+
+    uint8_t record[sizeof(ConfigRecordHeader) + sizeof(AppConfig)];
+    size_t len = prefs.getBytes(APP_CONFIG_KEY, record, sizeof(record));
+    prefs.end();
+    if (len < sizeof(ConfigRecordHeader)) return false;
+
+    ConfigRecordHeader header;
+    memcpy(&header, record, sizeof(header));
+    if (header.schema != APP_CONFIG_SCHEMA || header.size > sizeof(AppConfig) ||
+        len != sizeof(header) + header.size) {
+        return false;
+    }
+    memcpy(&config, record + sizeof(header), header.size);
+    return true;
+}
+
+void appConfigBegin(AppConfigHook hook) {
+    applyHook = hook;
+    AppConfig config = APP_CONFIG_DEFAULTS;
+    if (!load(config)) {
+        config = APP_CONFIG_DEFAULTS;
+    }
+    apply(config);
+}
+
+AppConfig appConfig() {
+    portENTER_CRITICAL(&configLock);
+    AppConfig copy = current;
+    portEXIT_CRITICAL(&configLock);
+    return copy;
+}
+
+bool appConfigGet(const AppConfig &config, uint8_t key, int32_t &value) {
+    switch (key) {
+        case CFG_TRIGGER_MARGIN_DB: value = config.levels.triggerMarginDb; break;
+        case CFG_MIN_TRIGGER_PEAK:  value = config.levels.minTriggerPeak; break;
+        case CFG_SCORE_THRESHOLD:   value = config.levels.scoreThreshold; break;
+        case CFG_GATE_MARGIN_DB:    value = config.levels.gateMarginDb; break;
+        case CFG_AGC_TARGET_PEAK:   value = config.levels.agcTargetPeak; break;
+        case CFG_AGC_MAX_GAIN:      value = config.levels.agcMaxGain; break;
+        case CFG_COOLDOWN_MS:       value = config.cooldownMs; break;
+        case CFG_RECORD_SECONDS:    value = config.recordSeconds; break;
+        case CFG_HEARTBEAT_MS:      value = config.heartbeatMs; break;
+        case CFG_DETECTOR:          value = config.detector; break;
+        default: return false;
+    }
+    return true;
+}
+
+static inline bool inRange(int32_t value, int32_t lo, int32_t hi) {
+    return value >= lo && value <= hi;
+}
+
+bool appConfigSet(AppConfig &config, uint8_t key, int32_t value) {
+    switch (key) {
+        case CFG_TRIGGER_MARGIN_DB:
+            if (!inRange(value, 0, 40)) return false;
+            config.levels.triggerMarginDb = (uint8_t)value;
+            break;
+        case CFG_MIN_TRIGGER_PEAK:
+            if (!inRange(value, 0, 32767)) return false;
+            config.levels.minTriggerPeak = (int16_t)value;
+            break;
+        case CFG_SCORE_THRESHOLD:
+            if (!inRange(value, -127, 127)) return false;
+            config.levels.scoreThreshold = (int8_t)value;
+            break;
+        case CFG_GATE_MARGIN_DB:
+            if (!inRange(value, 0, 40)) return false;
+            config.levels.gateMarginDb = (uint8_t)value;
+            break;
+        case CFG_AGC_TARGET_PEAK:
+            if (!inRange(value, 0, 32767)) return false;
+            config.levels.agcTargetPeak = (int16_t)value;
+            break;
+        case CFG_AGC_MAX_GAIN:
+            if (!inRange(value, 1, 64)) return false;
+            config.levels.agcMaxGain = (uint8_t)value;
+            break;
+        case CFG_COOLDOWN_MS:
+            if (!inRange(value, 0, 60000)) return false;
+            config.cooldownMs = (uint16_t)value;
+            break;
+        case CFG_RECORD_SECONDS:
+            // The pre-roll history is sized for PREROLL + margin, the clip
+            // itself streams; only SD space bounds it
+            if (!inRange(value, 1, 120)) return false;
+            config.recordSeconds = (uint8_t)value;
+            break;
+        case CFG_HEARTBEAT_MS:
+            if (!inRange(value, 1000, 60000)) return false;
+            config.heartbeatMs = (uint16_t)value;
+            break;
+        case CFG_DETECTOR:
+            if (value != DETECTOR_PEAK && value != DETECTOR_CLASSIFIER) return false;
+            config.detector = (VoiceDetector)value;
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+bool appConfigStore(const AppConfig &config) {
+    apply(config);
+
+    uint8_t record[sizeof(ConfigRecordHeader) + sizeof(AppConfig)];
+    ConfigRecordHeader header = {APP_CONFIG_SCHEMA, (uint16_t)sizeof(AppConfig)};
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), &config, sizeof(config));
+
+    Preferences prefs;
+    if (!prefs.begin(APP_CONFIG_NAMESPACE, false)) return false;
+    bool ok = prefs.putBytes(APP_CONFIG_KEY, record, sizeof(record)) == sizeof(record);
+    prefs.end();
+    return ok;
+}
+
+bool appConfigLoadSeqLimit(uint16_t &limit) {
+    limit = 0;
+    Preferences prefs;
+    if (!prefs.begin(APP_CONFIG_NAMESPACE, true)) return false;
+    bool found = prefs.isKey(APP_CONFIG_SEQ_KEY);
+    if (found) limit = prefs.getUShort(APP_CONFIG_SEQ_KEY, 0);
+    prefs.end();
+    return found;
+}
+
+bool appConfigStoreSeqLimit(uint16_t limit) {
+    Preferences prefs;
+    if (!prefs.begin(APP_CONFIG_NAMESPACE, false)) return false;
+    bool ok = prefs.putUShort(APP_CONFIG_SEQ_KEY, limit) == sizeof(limit);
+    prefs.end();
+    return ok;
+}
@@ -0,0 +1,64 @@
+// Runtime configuration, persisted in NVS and applied without a reboot
+#pragma once
+
+#include <Arduino.h>
+#include "audio_levels.h"
+#include "voice_detector.h"
+
+// NVS record: u16 schema, u16 size, then the AppConfig bytes. Fields are
+// only ever appended, so a record from an older schema is loaded over the
+// defaults and the new fields keep their default values. Bump the schema
+// for any other change; a record from a newer or unknown schema is ignored.
+#define APP_CONFIG_SCHEMA     1
+#define APP_CONFIG_NAMESPACE  "shield"
+#define APP_CONFIG_KEY        "cfg"
+#define APP_CONFIG_SEQ_KEY    "seq"       // Alert sequence reservation, see alert_log.h
+
+struct AppConfig {
+    AudioLevelConfig levels;
+    uint16_t cooldownMs;              // Minimum time between voice alerts
+    uint8_t recordSeconds;            // Clip length after the trigger
+    uint16_t heartbeatMs;             // Full status keepalive; changes are sent as they happen
+    VoiceDetector detector;           // Peak until the classifier ships a fitted table; CFG_DETECTOR selects it
+};
+
+#define APP_CONFIG_DEFAULTS {LEVEL_DEFAULT_CONFIG, 2000, 10, 30000, DETECTOR_PEAK}
+
+// Keys for reading and writing single fields over the command protocol
+enum AppConfigKey : uint8_t {
+    CFG_TRIGGER_MARGIN_DB = 1,
+    CFG_MIN_TRIGGER_PEAK,
+    CFG_SCORE_THRESHOLD,
+    CFG_GATE_MARGIN_DB,
+    CFG_AGC_TARGET_PEAK,
+    CFG_AGC_MAX_GAIN,
+    CFG_COOLDOWN_MS,
+    CFG_RECORD_SECONDS,
+    CFG_HEARTBEAT_MS,
+    CFG_DETECTOR,
+    CFG_KEY_END
+};
+
+// Called with the new config whenever it changes (including at begin)
+typedef void (*AppConfigHook)(const AppConfig &config);
+
+// Load from NVS (defaults if absent or unreadable) and apply. The hook may
+// be NULL.
+void appConfigBegin(AppConfigHook hook);
+
+// Copy of the current config; safe from any task
+AppConfig appConfig();
+
+// Range-checked single-field access; false for an unknown key or a value
+// out of range, in which case nothing changes
+bool appConfigGet(const AppConfig &config, uint8_t key, int32_t &value);
+bool appConfigSet(AppConfig &config, uint8_t key, int32_t value);
+
+// Apply and persist. False if the NVS write failed; the config is applied
+// either way.
+bool appConfigStore(const AppConfig &config);
+
+// First alert sequence number not yet reserved, under its own key so a
+// config write never touches it. Load is false (and limit 0) when absent.
+bool appConfigLoadSeqLimit(uint16_t &limit);
+bool appConfigStoreSeqLimit(uint16_t limit);
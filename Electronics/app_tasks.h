@@ -0,0 +1,78 @@
+// Task layout and inter-task events for the alert pipeline
+//
+//   Core 1 (audio)
+//     audio_capture  prio 5   I2S read, analyzer (classifier), history append
+//     detector       prio 4   sustained-trigger logic -> APP_EVT_TRIGGER
+//
+//   Core 0 (radio, GPS, state) - Bluedroid's own tasks run above all of these
+//     ble_tx         prio 4   alert/status notifies
+//     controller     prio 4   owns SystemState, consumes app events, power state (power_manager.h)
+//     esp_timer      prio 22  one-shot state timeouts -> APP_EVT_HOLD_EXPIRED
+//     gps            prio 3   Serial1 RMC/GGA -> TinyGPS++ under gpsMutex (gps_ingest.h)
+//     recorder       prio 3   history -> SD, alongside alerts and monitoring
+//     ble_xfer       prio 2   clip transfer
+//     imu            prio 2   optional accelerometer, fall/shake -> APP_EVT_TRIGGER (imu_detector.h)
+//
+//   Core 1, at boot only
+//     gps/storage/   prio 1   one subsystem each, -> APP_EVT_BOOT_STAGE (boot_sequence.h)
+//     audio/imu
+//
+// The Arduino loopTask deletes itself after setup(). Triggers, connection
+// changes, recorder completion and state timeouts reach the controller only
+// through appEventQueue, where a transition table (state_machine.h) turns
+// them into state changes; connection and monitoring state are also bits in
+// appEventGroup for readers on other tasks. Nothing else is shared between
+// tasks.
+//
+// Latency budget, trigger to alert notify on air:
+//   pin:   ISR -> controller wake            < 0.1 ms   timestamp + send to the queue front, nothing else
+//   voice: frame end -> analyzer done        ~ 2 ms     2 FFTs + autocorrelation
+//          sustain window                    200 ms     TRIGGER_SAMPLES_NEEDED frames, by design
+//          detector -> controller            < 0.1 ms
+//   both:  build frame + enqueue             < 1 ms     GPS mutex held for one copy
+//          ble_tx wake -> notify queued      < 1 ms     unless the controller is congested
+//          wait for connection event         <= 30 ms   fast profile, 15-30 ms interval
+// Worst case is ~32 ms for the pin and ~235 ms for voice. TRACE() points
+// (trace.h) measure each step; tools/trace_histogram.py prints the spans.
+#pragma once
+
+#include <Arduino.h>
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+
+#define CONTROLLER_TASK_CORE     0
+#define CONTROLLER_TASK_PRIORITY 4
+#define CONTROLLER_TASK_STACK    4096
+#define CONTROLLER_TICK_MS       50   // Housekeeping cadence when no events arrive
+
+#define DETECTOR_TASK_CORE       1    // Next to audio capture
+#define DETECTOR_TASK_PRIORITY   4
+#define DETECTOR_TASK_STACK      3072
+
+#define APP_EVENT_QUEUE_DEPTH    16
+
+// Pin path budget: edge to alert notify handed to the stack
+#define PIN_LATENCY_TARGET_US    20000
+
+enum AppEventType : uint8_t {
+    APP_EVT_TRIGGER,                  // Scored detector event, see trigger_fusion.h
+    APP_EVT_TEST,                     // CMD_TEST_ALERT from the app
+    APP_EVT_COMMAND,                  // Request queued by commandOnWrite()
+    APP_EVT_CONNECT,
+    APP_EVT_DISCONNECT,
+    APP_EVT_HOLD_EXPIRED,             // Post-alert hold timer
+    APP_EVT_RECORDING_DONE,           // Recorder closed the file
+    APP_EVT_BOOT_STAGE                // A subsystem finished starting, see boot_sequence.h
+};
+
+struct AppEvent {
+    AppEventType type;
+    int64_t timestamp_us;             // esp_timer time of the trigger (frame end for voice)
+    uint8_t source;                   // APP_EVT_TRIGGER: TriggerSource; APP_EVT_BOOT_STAGE: BootStage
+    uint8_t score;                    // ... and its score, TRIGGER_SCORE_CERTAIN = sure; 1 if the stage is up
+};
+
+// appEventGroup bits
+#define APP_BIT_CONNECTED   (1 << 0)
+#define APP_BIT_MONITORING  (1 << 1)  // Detector frames are only acted on while set
+#define APP_BIT_RECORDING_DONE (1 << 2) // Set by the recorder, taken by the controller; the queued event only wakes it
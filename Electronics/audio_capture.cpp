@@ -0,0 +1,160 @@
+#include "audio_capture.h"
+#include <atomic>
+#include <I2S.h>
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "spsc_ring.h"
+#include "trace.h"
+
+static SpscRing<AudioFrame, AUDIO_RING_FRAMES> audioRing;
+static AudioFrame overflowFrame;      // Keeps the DMA drained when the ring is full
+static volatile uint32_t droppedFrames = 0;
+static TaskHandle_t captureTaskHandle = NULL;
+static SemaphoreHandle_t frameReady = NULL;
+static volatile AudioTap frameTap = NULL;
+static volatile AudioAnalyzer frameAnalyzer = NULL;
+
+static int16_t *historyBuf = NULL;
+static uint32_t historyMask = 0;
+static std::atomic<uint32_t> historyHead{0};
+static std::atomic<uint32_t> historyHeld{0};
+
+// Capture task only
+static void historyAppend(const AudioFrame *frame) {
+    if (historyBuf == NULL) return;
+
+    uint32_t head = historyHead.load(std::memory_order_relaxed);
+    uint32_t start = head & historyMask;
+    uint32_t first = historyMask + 1 - start;
+    if (first > frame->sample_count) first = frame->sample_count;
+    memcpy(&historyBuf[start], frame->samples, first * sizeof(int16_t));
+    memcpy(historyBuf, &frame->samples[first], (frame->sample_count - first) * sizeof(int16_t));
+
+    historyHead.store(head + frame->sample_count, std::memory_order_release);
+    uint32_t held = historyHeld.load(std::memory_order_relaxed) + frame->sample_count;
+    historyHeld.store(held > historyMask + 1 ? historyMask + 1 : held, std::memory_order_release);
+}
+
+static void audioCaptureTask(void *arg) {
+    for (;;) {
+        AudioFrame *frame = audioRing.writeSlot();
+        bool dropping = (frame == nullptr);
+        if (dropping) {
+            frame = &overflowFrame;
+        }
+
+        size_t bytesRead = 0;
+        esp_i2s::i2s_read(esp_i2s::I2S_NUM_0, frame->samples, AUDIO_FRAME_BYTES, &bytesRead, portMAX_DELAY);
+        if (bytesRead == 0) continue;
+        TRACE(TRACE_FRAME_READ, dropping);
+
+        frame->timestamp_us = esp_timer_get_time();
+        frame->sample_count = bytesRead / sizeof(int16_t);
+        frame->peak = 0;
+        frame->score = 0;
+
+        AudioAnalyzer analyzer = frameAnalyzer;
+        if (analyzer != NULL) {
+            analyzer(frame);
+            TRACE(TRACE_FRAME_ANALYZED, frame->score);
+        }
+
+        historyAppend(frame);
+
+        AudioTap tap = frameTap;
+        if (tap != NULL) {
+            tap(frame);
+        }
+
+        if (dropping) {
+            droppedFrames++;
+            continue;
+        }
+        audioRing.commitWrite();
+        xSemaphoreGive(frameReady);
+    }
+}
+
+bool audioCaptureBegin() {
+    if (captureTaskHandle != NULL) return true;
+
+    frameReady = xSemaphoreCreateBinary();
+    if (frameReady == NULL) return false;
+
+    BaseType_t ok = xTaskCreatePinnedToCore(audioCaptureTask, "audio_capture", AUDIO_CAPTURE_STACK,
+                                            NULL, AUDIO_CAPTURE_PRIORITY, &captureTaskHandle,
+                                            AUDIO_CAPTURE_CORE);
+    return ok == pdPASS;
+}
+
+bool audioHistoryBegin(uint32_t minDurationMs) {
+    if (historyBuf != NULL) return true;
+
+    uint32_t wanted = (uint32_t)((uint64_t)AUDIO_SAMPLE_RATE * minDurationMs / 1000);
+    // Power of two so free-running positions mask cleanly across wraparound
+    uint32_t capacity = 1;
+    while (capacity < wanted || capacity < 2 * AUDIO_FRAME_SAMPLES) capacity <<= 1;
+
+    historyBuf = (int16_t *)ps_malloc(capacity * sizeof(int16_t));
+    if (historyBuf == NULL) return false;
+    historyMask = capacity - 1;
+    return true;
+}
+
+uint32_t audioHistoryPosition() {
+    return historyHead.load(std::memory_order_acquire);
+}
+
+uint32_t audioHistoryAvailable() {
+    return historyHeld.load(std::memory_order_acquire);
+}
+
+uint32_t audioHistoryCapacity() {
+    return historyBuf != NULL ? historyMask + 1 : 0;
+}
+
+size_t audioHistoryRead(uint32_t pos, int16_t *dst, size_t count) {
+    if (historyBuf == NULL) return 0;
+
+    uint32_t head = historyHead.load(std::memory_order_acquire);
+    uint32_t behind = head - pos;
+    if (behind > historyHeld.load(std::memory_order_acquire)) return 0;
+    if (count > behind) count = behind;
+
+    uint32_t start = pos & historyMask;
+    uint32_t first = historyMask + 1 - start;
+    if (first > count) first = count;
+    memcpy(dst, &historyBuf[start], first * sizeof(int16_t));
+    memcpy(&dst[first], historyBuf, (count - first) * sizeof(int16_t));
+
+    // Capture may have lapped us while copying the oldest samples; it writes
+    // up to one frame ahead of the published head
+    uint32_t reach = historyHead.load(std::memory_order_acquire) + AUDIO_FRAME_SAMPLES - pos;
+    if (reach > historyMask + 1) return 0;
+    return count;
+}
+
+void audioCaptureRelease() {
+    audioRing.releaseRead();
+}
+
+const AudioFrame *audioCaptureWaitFrame(TickType_t timeout) {
+    const AudioFrame *frame = audioRing.readSlot();
+    if (frame != nullptr || frameReady == NULL) return frame;
+
+    // Binary semaphore: one give may cover several frames, the caller drains
+    xSemaphoreTake(frameReady, timeout);
+    return audioRing.readSlot();
+}
+
+void audioCaptureSetTap(AudioTap tap) {
+    frameTap = tap;
+}
+
+void audioCaptureSetAnalyzer(AudioAnalyzer analyzer) {
+    frameAnalyzer = analyzer;
+}
+
+uint32_t audioCaptureDroppedFrames() {
+    return droppedFrames;
+}
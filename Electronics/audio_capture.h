@@ -0,0 +1,60 @@
+// Audio capture task - owns the I2S PDM input and feeds the detector
+#pragma once
+
+#include <Arduino.h>
+#include "audio_frame.h"
+
+#define AUDIO_RING_FRAMES      8      // 400ms of slack for a slow detector task
+
+// Task placement: core 1 with the detector task and, during boot, the
+// startup tasks (app_tasks.h), but above both so neither can hold off an
+// I2S read. The controller runs on core 0.
+#define AUDIO_CAPTURE_CORE     1
+#define AUDIO_CAPTURE_PRIORITY 5
+#define AUDIO_CAPTURE_STACK    4096
+
+// Called on the capture task for every frame read, including frames the
+// detector ring had no room for. Must not block.
+typedef void (*AudioTap)(const AudioFrame *frame);
+
+// Called on the capture task before the tap and before the frame is handed
+// to the consumer, so per-frame detection runs in real time next to the
+// I2S read. May fill peak/score; must not modify the samples.
+typedef void (*AudioAnalyzer)(AudioFrame *frame);
+
+// Start the capture task. I2S must already be initialized.
+bool audioCaptureBegin();
+
+// Consumer side: next unread frame, waiting up to timeout, or nullptr.
+// Call audioCaptureRelease() once finished with it so the slot can be reused.
+const AudioFrame *audioCaptureWaitFrame(TickType_t timeout);
+void audioCaptureRelease();
+
+// Install (or clear with NULL) the per-frame tap
+void audioCaptureSetTap(AudioTap tap);
+
+// Install (or clear with NULL) the per-frame analyzer
+void audioCaptureSetAnalyzer(AudioAnalyzer analyzer);
+
+// Sample history: every captured sample is also appended to a circular
+// buffer (PSRAM when available) addressed by an absolute, free-running
+// sample position. Readers keep their own positions, so the recorder can
+// lag behind capture or start in the past without anyone copying frames.
+// Must be called before audioCaptureBegin(); capacity is rounded up to a
+// power of two samples.
+bool audioHistoryBegin(uint32_t minDurationMs);
+
+// Position one past the newest sample written
+uint32_t audioHistoryPosition();
+
+// Samples currently retained (grows to the capacity, then stays there)
+uint32_t audioHistoryAvailable();
+uint32_t audioHistoryCapacity();
+
+// Copy count samples starting at absolute position pos. Returns the number
+// copied: fewer if the range extends past the newest sample, 0 if pos has
+// already been overwritten.
+size_t audioHistoryRead(uint32_t pos, int16_t *dst, size_t count);
+
+// Frames dropped because the consumer fell more than AUDIO_RING_FRAMES behind
+uint32_t audioCaptureDroppedFrames();
@@ -0,0 +1,20 @@
+// Audio frame layout, shared by capture, detection and the host replay harness
+#pragma once
+
+#include <stdint.h>
+
+// One frame is one detector window (50ms at 16kHz mono)
+#define AUDIO_SAMPLE_RATE      16000U
+#define AUDIO_FRAME_MS         50
+#define AUDIO_FRAME_SAMPLES    (AUDIO_SAMPLE_RATE * AUDIO_FRAME_MS / 1000)
+#define AUDIO_FRAME_BYTES      (AUDIO_FRAME_SAMPLES * sizeof(int16_t))
+
+// Samples lead the struct so they stay aligned for the vector kernels
+struct AudioFrame {
+    alignas(16) int16_t samples[AUDIO_FRAME_SAMPLES];
+    int64_t timestamp_us;             // esp_timer_get_time() when the frame completed
+    uint16_t sample_count;
+    int16_t peak;                     // Filled in by the analyzer, if any
+    int16_t rms;
+    int8_t score;
+};
@@ -0,0 +1,48 @@
+#include "audio_levels.h"
+#include "fixed_format.h"
+
+static portMUX_TYPE configLock = portMUX_INITIALIZER_UNLOCKED;
+static AudioLevelConfig config = LEVEL_DEFAULT_CONFIG;
+static volatile float floorDb = LEVEL_FLOOR_INIT_DB;
+
+void audioLevelsUpdate(int16_t rms) {
+    float db = audioLevelDb(rms);
+    if (db < LEVEL_FLOOR_MIN_DB) db = LEVEL_FLOOR_MIN_DB;
+    float current = floorDb;
+    float alpha = db < current ? LEVEL_FLOOR_ALPHA_DOWN : LEVEL_FLOOR_ALPHA_UP;
+    floorDb = current + alpha * (db - current);
+}
+
+void audioLevelsReset() {
+    floorDb = LEVEL_FLOOR_INIT_DB;
+}
+
+float audioNoiseFloorDb() {
+    return floorDb;
+}
+
+int16_t audioGateThreshold() {
+    float db = floorDb + audioLevelConfig().gateMarginDb;
+    float level = 32768.0f * powf(10.0f, db / 20.0f);
+    return level > 32767.0f ? 32767 : (int16_t)level;
+}
+
+AudioLevelConfig audioLevelConfig() {
+    portENTER_CRITICAL(&configLock);
+    AudioLevelConfig copy = config;
+    portEXIT_CRITICAL(&configLock);
+    return copy;
+}
+
+void audioLevelSetConfig(const AudioLevelConfig &next) {
+    portENTER_CRITICAL(&configLock);
+    config = next;
+    portEXIT_CRITICAL(&configLock);
+}
+
+void audioLevelPrint(Print &out) {
+    AudioLevelConfig c = audioLevelConfig();
+    fixedLog(out, "Levels: floor %.1f dBFS, margin %u dB, peak %d, score %d, gate +%u dB (%d), agc %d, maxgain %u\n",
+             audioNoiseFloorDb(), c.triggerMarginDb, c.minTriggerPeak, c.scoreThreshold,
+             c.gateMarginDb, audioGateThreshold(), c.agcTargetPeak, c.agcMaxGain);
+}
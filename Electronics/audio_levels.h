@@ -0,0 +1,49 @@
+// Ambient noise floor and the level settings derived from it
+#pragma once
+
+#include <math.h>
+#include "platform.h"
+
+// The floor is an EMA of frame RMS in dB that falls quickly and rises
+// slowly, so it tracks the quiet between sounds rather than the sounds
+// themselves. Coefficients are per AUDIO_FRAME_MS frame.
+#define LEVEL_FLOOR_ALPHA_DOWN 0.10f  // ~0.5 s towards quieter
+#define LEVEL_FLOOR_ALPHA_UP   0.005f // ~10 s towards louder
+#define LEVEL_FLOOR_INIT_DB    -50.0f
+#define LEVEL_FLOOR_MIN_DB     -70.0f // Below the mic's self-noise
+
+// Runtime-tunable levels (part of AppConfig, see app_config.h). Triggers
+// need the frame RMS to clear the floor by triggerMarginDb on top of the
+// detector's own test, so a steady loud background stops counting as a
+// scream.
+struct AudioLevelConfig {
+    uint8_t triggerMarginDb;
+    int16_t minTriggerPeak;           // Peak detector: absolute minimum
+    int8_t scoreThreshold;            // Classifier logit a frame must beat
+    uint8_t gateMarginDb;             // Recorder gate sits this far above the floor
+    int16_t agcTargetPeak;            // Recorder AGC output peak, 0 = fixed gain
+    uint8_t agcMaxGain;               // Recorder AGC maximum (or fixed) gain
+};
+
+#define LEVEL_DEFAULT_CONFIG {12, 2300, 16, 3, 16384, 16}
+
+// Capture task, once per frame
+void audioLevelsUpdate(int16_t rms);
+
+// Back to LEVEL_FLOOR_INIT_DB (the replay harness, between clips)
+void audioLevelsReset();
+
+float audioNoiseFloorDb();
+
+// Recorder gate threshold in raw sample units
+int16_t audioGateThreshold();
+
+// Config is read from several tasks; get and set copy the whole struct
+AudioLevelConfig audioLevelConfig();
+void audioLevelSetConfig(const AudioLevelConfig &config);
+
+void audioLevelPrint(Print &out);
+
+static inline float audioLevelDb(float rms) {
+    return rms > 0 ? 20.0f * log10f(rms / 32768.0f) : LEVEL_FLOOR_MIN_DB;
+}
@@ -0,0 +1,96 @@
+#include "ble_link.h"
+#include <BLE2902.h>
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+
+enum LinkProfile {
+    LINK_NONE,
+    LINK_FAST,
+    LINK_SLOW
+};
+
+static BLEServer *linkServer = nullptr;
+static esp_bd_addr_t peerAddress;
+static volatile bool peerConnected = false;
+static volatile uint16_t peerConnId = 0;
+static volatile uint16_t negotiatedMtu = 23;
+static LinkProfile appliedProfile = LINK_NONE;
+static unsigned long fastUntil = 0;
+
+static void applyProfile(LinkProfile profile) {
+    if (!peerConnected || profile == appliedProfile) return;
+
+    if (profile == LINK_FAST) {
+        linkServer->updateConnParams(peerAddress, BLE_LINK_FAST_MIN_INTERVAL, BLE_LINK_FAST_MAX_INTERVAL,
+                                     BLE_LINK_FAST_LATENCY, BLE_LINK_FAST_TIMEOUT);
+    } else {
+        linkServer->updateConnParams(peerAddress, BLE_LINK_SLOW_MIN_INTERVAL, BLE_LINK_SLOW_MAX_INTERVAL,
+                                     BLE_LINK_SLOW_LATENCY, BLE_LINK_SLOW_TIMEOUT);
+    }
+    appliedProfile = profile;
+}
+
+void bleLinkBegin(BLEServer *server) {
+    linkServer = server;
+    BLEDevice::setMTU(BLE_LINK_MTU);
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+    esp_ble_gap_set_prefered_default_phy(ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_2M_PREF_MASK);
+#endif
+}
+
+void bleLinkOnConnect(esp_ble_gatts_cb_param_t *param) {
+    memcpy(peerAddress, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+    peerConnId = param->connect.conn_id;
+    peerConnected = true;
+    negotiatedMtu = 23;
+    appliedProfile = LINK_NONE;
+
+    // Longest LL payload so a full-MTU notify isn't split into 27-byte PDUs
+    esp_ble_gap_set_pkt_data_len(peerAddress, 251);
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+    esp_ble_gap_set_prefered_phy(peerAddress, 0, ESP_BLE_GAP_PHY_2M_PREF_MASK,
+                                 ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_OPTIONS_NO_PREF);
+#endif
+
+    // Start fast so service discovery and the MTU exchange finish quickly;
+    // bleLinkPoll() applies it from the loop task
+    bleLinkBoost();
+}
+
+void bleLinkOnDisconnect() {
+    peerConnected = false;
+    negotiatedMtu = 23;
+    appliedProfile = LINK_NONE;
+}
+
+void bleLinkOnMtuChanged(esp_ble_gatts_cb_param_t *param) {
+    negotiatedMtu = param->mtu.mtu;
+}
+
+void bleLinkBoost() {
+    fastUntil = millis() + BLE_LINK_FAST_HOLD_MS;
+}
+
+void bleLinkPoll() {
+    if ((long)(millis() - fastUntil) < 0) {
+        applyProfile(LINK_FAST);
+    } else {
+        applyProfile(LINK_SLOW);
+    }
+}
+
+bool bleLinkNotify(BLECharacteristic *characteristic, const uint8_t *data, size_t len) {
+    if (!peerConnected || linkServer == nullptr) return false;
+
+    BLE2902 *cccd = (BLE2902 *)characteristic->getDescriptorByUUID(BLEUUID((uint16_t)0x2902));
+    if (cccd == nullptr || !cccd->getNotifications()) return false;
+
+    esp_err_t err = esp_ble_gatts_send_indicate(linkServer->getGattsIf(), peerConnId,
+                                                characteristic->getHandle(), len,
+                                                (uint8_t *)data, false);
+    return err == ESP_OK;
+}
+
+uint16_t bleLinkMtu() {
+    return negotiatedMtu;
+}
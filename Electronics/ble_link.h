@@ -0,0 +1,48 @@
+// BLE link tuning - MTU, PHY and per-state connection parameters
+#pragma once
+
+#include <Arduino.h>
+#include <BLEDevice.h>
+
+#define BLE_LINK_MTU 517
+
+// Connection interval units are 1.25ms, supervision timeout units 10ms.
+// Fast: shortest interval iOS accepts, no latency, for alerts and transfers.
+#define BLE_LINK_FAST_MIN_INTERVAL 12       // 15ms
+#define BLE_LINK_FAST_MAX_INTERVAL 24       // 30ms
+#define BLE_LINK_FAST_LATENCY      0
+#define BLE_LINK_FAST_TIMEOUT      400      // 4s
+
+// Slow: the phone only has to wake every (latency + 1) intervals, ~1s here
+#define BLE_LINK_SLOW_MIN_INTERVAL 80       // 100ms
+#define BLE_LINK_SLOW_MAX_INTERVAL 160      // 200ms
+#define BLE_LINK_SLOW_LATENCY      4
+#define BLE_LINK_SLOW_TIMEOUT      600      // 6s, > 2 * (latency + 1) * max interval
+
+// Stay on the fast profile this long after the last boost so the alert
+// notify and the app's follow-up traffic don't straddle a slowdown
+#define BLE_LINK_FAST_HOLD_MS      3000
+
+// Raise the local MTU and preferred PHY. Call after BLEDevice::init().
+void bleLinkBegin(BLEServer *server);
+
+// Forward from BLEServerCallbacks
+void bleLinkOnConnect(esp_ble_gatts_cb_param_t *param);
+void bleLinkOnDisconnect();
+void bleLinkOnMtuChanged(esp_ble_gatts_cb_param_t *param);
+
+// Request the fast profile now and for BLE_LINK_FAST_HOLD_MS afterwards
+void bleLinkBoost();
+
+// Call from loop(): falls back to the slow profile once the hold expires
+void bleLinkPoll();
+
+// Notify the connected central straight from data. BLECharacteristic's
+// setValue() + notify() copies the value into a std::string and scans the
+// peer map on every call; this checks the CCCD and hands the buffer to the
+// stack as-is. False when nobody is connected or subscribed, or the stack
+// refuses it (ESP_GATTS_CONF_EVT reports later failures).
+bool bleLinkNotify(BLECharacteristic *characteristic, const uint8_t *data, size_t len);
+
+// Negotiated ATT MTU (23 until the central exchanges MTU); payload is MTU - 3
+uint16_t bleLinkMtu();
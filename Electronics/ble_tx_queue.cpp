@@ -0,0 +1,161 @@
+#include "ble_tx_queue.h"
+#include <atomic>
+#include "ble_link.h"
+#include "spsc_ring.h"
+#include "esp_timer.h"
+#include "trace.h"
+
+struct BleTxMessage {
+    uint8_t priority;                 // BleTxPriority, for the trace
+    uint16_t len;
+    uint16_t tag;                     // Alerts: returned with the outcome
+    uint8_t data[BLE_TX_MAX_PAYLOAD];
+};
+
+static BLECharacteristic *txChar = nullptr;
+static QueueHandle_t alertQueue = NULL;
+static QueueHandle_t responseQueue = NULL;
+static QueueHandle_t statusQueue = NULL;   // Depth 1, overwritten
+static TaskHandle_t txTaskHandle = NULL;
+
+// TX task -> alert log (controller)
+static SpscRing<BleTxAlertResult, BLE_TX_RESULT_DEPTH> alertResults;
+
+static std::atomic<bool> congested{false};
+static BleTxStats stats = {};
+
+// Runs on the Bluedroid task, chained in front of the library's handler
+static void txGattsHandler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param) {
+    switch (event) {
+        case ESP_GATTS_CONGEST_EVT:
+            congested = param->congest.congested;
+            if (param->congest.congested) {
+                stats.congestionEvents++;
+            } else if (txTaskHandle != NULL) {
+                xTaskNotifyGive(txTaskHandle);
+            }
+            break;
+        case ESP_GATTS_CONF_EVT:
+            if (param->conf.status != 0) {
+                stats.notifyErrors++;
+            }
+            break;
+        case ESP_GATTS_DISCONNECT_EVT:
+            congested = false;
+            break;
+        default:
+            break;
+    }
+}
+
+static void reportAlert(const BleTxMessage &msg, bool sent) {
+    if (msg.priority != BLE_TX_ALERT) return;
+    if (!alertResults.push({msg.tag, sent})) stats.resultsLost++;
+}
+
+static void bleTxTask(void *arg) {
+    BleTxMessage msg;
+    for (;;) {
+        bool isAlert = xQueueReceive(alertQueue, &msg, 0) == pdTRUE;
+        if (!isAlert && xQueueReceive(responseQueue, &msg, 0) != pdTRUE &&
+            xQueueReceive(statusQueue, &msg, 0) != pdTRUE) {
+            // Woken by bleTxEnqueue(); a give between the checks above and
+            // here is not lost because the notification count persists
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        // Back-pressure: let the controller drain before queueing more
+        while (congested) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BLE_TX_CONGEST_POLL_MS));
+        }
+
+        // Anything longer than the negotiated payload would be cut by the
+        // stack and fail its CRC at the app; an alert is retried by the log
+        // once the MTU exchange has raised the limit
+        if (msg.len > bleLinkMtu() - 3) {
+            stats.oversized++;
+            reportAlert(msg, false);
+            continue;
+        }
+        if (!bleLinkNotify(txChar, msg.data, msg.len)) {
+            stats.notifyErrors++;
+            reportAlert(msg, false);
+            continue;
+        }
+        reportAlert(msg, true);
+        TRACE(TRACE_NOTIFY_SENT, msg.priority);
+        stats.sent++;
+        if (isAlert) {
+            stats.lastAlertSentUs = esp_timer_get_time();
+        }
+    }
+}
+
+bool bleTxBegin(BLECharacteristic *txCharacteristic) {
+    if (txTaskHandle != NULL) return true;
+
+    txChar = txCharacteristic;
+    alertQueue = xQueueCreate(BLE_TX_ALERT_DEPTH, sizeof(BleTxMessage));
+    responseQueue = xQueueCreate(BLE_TX_RESPONSE_DEPTH, sizeof(BleTxMessage));
+    statusQueue = xQueueCreate(1, sizeof(BleTxMessage));
+    if (alertQueue == NULL || responseQueue == NULL || statusQueue == NULL) return false;
+
+    BLEDevice::setCustomGattsHandler(txGattsHandler);
+
+    BaseType_t ok = xTaskCreatePinnedToCore(bleTxTask, "ble_tx", BLE_TX_TASK_STACK, NULL,
+                                            BLE_TX_TASK_PRIORITY, &txTaskHandle, BLE_TX_TASK_CORE);
+    return ok == pdPASS;
+}
+
+static bool enqueue(BleTxPriority priority, const uint8_t *data, size_t len, uint16_t tag) {
+    if (txTaskHandle == NULL) return false;
+
+    BleTxMessage msg;
+    msg.priority = priority;
+    msg.tag = tag;
+    msg.len = len > BLE_TX_MAX_PAYLOAD ? BLE_TX_MAX_PAYLOAD : len;
+    memcpy(msg.data, data, msg.len);
+
+    if (priority == BLE_TX_ALERT || priority == BLE_TX_RESPONSE) {
+        QueueHandle_t queue = priority == BLE_TX_ALERT ? alertQueue : responseQueue;
+        if (xQueueSend(queue, &msg, 0) != pdTRUE) {
+            stats.dropped++;
+            return false;
+        }
+    } else {
+        xQueueOverwrite(statusQueue, &msg);
+    }
+
+    TRACE(TRACE_NOTIFY_QUEUED, priority);
+    stats.queued++;
+    xTaskNotifyGive(txTaskHandle);
+    return true;
+}
+
+bool bleTxEnqueue(BleTxPriority priority, const uint8_t *data, size_t len) {
+    return enqueue(priority, data, len, 0);
+}
+
+bool bleTxEnqueueAlert(const uint8_t *data, size_t len, uint16_t tag) {
+    return enqueue(BLE_TX_ALERT, data, len, tag);
+}
+
+bool bleTxTakeAlertResult(BleTxAlertResult &result) {
+    return alertResults.pop(result);
+}
+
+bool bleTxEnqueueText(BleTxPriority priority, const char *text) {
+    return bleTxEnqueue(priority, (const uint8_t *)text, strlen(text));
+}
+
+bool bleTxLinkBusy() {
+    return congested || (alertQueue != NULL && uxQueueMessagesWaiting(alertQueue) > 0);
+}
+
+BleTxStats bleTxStats() {
+    BleTxStats snapshot = stats;
+    snapshot.alertDepth = alertQueue != NULL ? uxQueueMessagesWaiting(alertQueue) : 0;
+    snapshot.congested = congested;
+    return snapshot;
+}
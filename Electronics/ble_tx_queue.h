@@ -0,0 +1,63 @@
+// Outbound BLE notification queue - the only code that touches the TX characteristic
+#pragma once
+
+#include <Arduino.h>
+#include <BLEDevice.h>
+
+#define BLE_TX_MAX_PAYLOAD   244      // Largest notify payload at a 247-byte MTU
+#define BLE_TX_ALERT_DEPTH   8
+#define BLE_TX_RESPONSE_DEPTH 4
+#define BLE_TX_CONGEST_POLL_MS 20     // Re-check interval while the stack is congested
+#define BLE_TX_RESULT_DEPTH  16       // Alert outcomes not yet taken, power of two
+
+#define BLE_TX_TASK_CORE     0        // With the Bluedroid host
+#define BLE_TX_TASK_PRIORITY 4
+#define BLE_TX_TASK_STACK    3072
+
+// Alerts always go out before command responses, and responses before
+// status. Responses are kept in order; status messages are coalesced: only
+// the newest pending one is kept, so a stalled link never backs up heartbeats.
+enum BleTxPriority {
+    BLE_TX_ALERT,
+    BLE_TX_RESPONSE,
+    BLE_TX_STATUS
+};
+
+struct BleTxStats {
+    uint32_t queued;
+    uint32_t sent;
+    uint32_t dropped;                 // Alert or response queue full
+    uint32_t notifyErrors;            // Reported through onStatus / CONF_EVT
+    uint32_t oversized;               // Longer than the MTU allows, not sent
+    uint32_t congestionEvents;
+    uint16_t alertDepth;              // Alerts waiting right now
+    bool congested;
+    int64_t lastAlertSentUs;          // esp_timer time the newest alert went to the stack
+    uint32_t resultsLost;             // Alert outcomes dropped, result ring full
+};
+
+// What became of an alert queued with bleTxEnqueueAlert()
+struct BleTxAlertResult {
+    uint16_t tag;
+    bool sent;                        // Handed to the stack; false if the notify was refused
+};
+
+// Start the drain task for the given characteristic and hook the GATTS
+// congestion events. Call after the characteristic has been created.
+bool bleTxBegin(BLECharacteristic *txCharacteristic);
+
+// Copy a message into the queue. Never blocks; false if the alert or
+// response queue is full.
+bool bleTxEnqueue(BleTxPriority priority, const uint8_t *data, size_t len);
+bool bleTxEnqueueText(BleTxPriority priority, const char *text);
+
+// An alert whose outcome the sender needs: once the TX task has tried the
+// notify, tag comes back from bleTxTakeAlertResult() (single consumer)
+bool bleTxEnqueueAlert(const uint8_t *data, size_t len, uint16_t tag);
+bool bleTxTakeAlertResult(BleTxAlertResult &result);
+
+// True while alerts are waiting or the link is congested; bulk senders on
+// other characteristics should hold off
+bool bleTxLinkBusy();
+
+BleTxStats bleTxStats();
@@ -0,0 +1,321 @@
+#include "ble_xfer.h"
+#include "FS.h"
+#include "sd_storage.h"
+#include "ble_link.h"
+#include "ble_tx_queue.h"
+#include "recording_catalog.h"
+
+// Internal commands share the queue so only the task touches the file and
+// the characteristic
+#define XFER_INT_READY      0x70
+#define XFER_INT_DISCONNECT 0x71
+
+struct XferCommand {
+    uint8_t op;
+    uint32_t offset;
+    char path[XFER_PATH_MAX];
+};
+
+static BLECharacteristic *xferChar = nullptr;
+static QueueHandle_t cmdQueue = NULL;
+static TaskHandle_t xferTaskHandle = NULL;
+
+// Task-owned transfer state
+static File xferFile;
+static char openPath[XFER_PATH_MAX] = "";
+static char latestPath[XFER_PATH_MAX] = "";
+static uint32_t fileSize = 0;
+static uint32_t filePos = 0;
+static uint32_t sendOffset = 0;
+static uint32_t ackedOffset = 0;
+static uint32_t rewindEnd = 0;        // sendOffset when the last rewind happened
+static uint16_t chunkSize = 0;
+static bool streaming = false;
+static bool doneSent = false;
+static unsigned long lastAckTime = 0;
+static BleXferStats stats = {};
+
+static uint8_t pkt[XFER_DATA_HEADER + XFER_MAX_PAYLOAD];
+
+static inline void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t *p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline uint32_t get32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void sendPacket(size_t len) {
+    bleLinkNotify(xferChar, pkt, len);
+}
+
+static void sendError(uint8_t code) {
+    pkt[0] = XFER_EVT_ERROR;
+    pkt[1] = code;
+    sendPacket(2);
+}
+
+static size_t putPath(uint8_t *dst, const char *path, size_t room) {
+    size_t n = strlen(path);
+    if (n > room) n = room;
+    memcpy(dst, path, n);
+    return n;
+}
+
+static uint16_t currentChunkSize() {
+    uint16_t mtuPayload = bleLinkMtu() - 3 - XFER_DATA_HEADER;
+    return mtuPayload < XFER_MAX_PAYLOAD ? mtuPayload : XFER_MAX_PAYLOAD;
+}
+
+static void closeFile() {
+    if (xferFile) xferFile.close();
+    streaming = false;
+}
+
+static void handleOpen(const XferCommand &cmd) {
+    // Empty path: the latest clip, or after a reset the oldest one the app
+    // has not had yet
+    const char *path = cmd.path[0] != '\0' ? cmd.path : latestPath;
+    CatalogClip pending;
+    if (path[0] == '\0' && catalogNextPending(pending)) {
+        catalogClipPath(pending.id, latestPath, sizeof(latestPath));
+    }
+    closeFile();
+
+    if (path[0] == '\0' || !(xferFile = sdStorage().open(path, FILE_READ))) {
+        openPath[0] = '\0';
+        sendError(XFER_ERR_NOT_FOUND);
+        return;
+    }
+
+    strncpy(openPath, path, XFER_PATH_MAX - 1);
+    openPath[XFER_PATH_MAX - 1] = '\0';
+    fileSize = xferFile.size();
+    filePos = 0;
+    chunkSize = currentChunkSize();
+
+    pkt[0] = XFER_EVT_INFO;
+    put32(&pkt[1], fileSize);
+    put16(&pkt[5], chunkSize);
+    pkt[7] = XFER_WINDOW_CHUNKS;
+    size_t len = 8 + putPath(&pkt[8], openPath, bleLinkMtu() - 3 - 8);
+    sendPacket(len);
+}
+
+static void handleStart(const XferCommand &cmd) {
+    if (!xferFile) {
+        sendError(XFER_ERR_NOT_OPEN);
+        return;
+    }
+    if (cmd.offset > fileSize) {
+        sendError(XFER_ERR_BAD_OFFSET);
+        return;
+    }
+
+    chunkSize = currentChunkSize();
+    sendOffset = cmd.offset;
+    ackedOffset = cmd.offset;
+    rewindEnd = 0;
+    lastAckTime = millis();
+    doneSent = false;
+    streaming = true;
+}
+
+// Resend everything unacknowledged. Duplicate ACKs for chunks that were
+// already in flight at the rewind mean the same loss, so none of them
+// rewinds again until the resend has caught up with where it left off.
+static void rewind() {
+    rewindEnd = sendOffset;
+    sendOffset = ackedOffset;
+    doneSent = false;
+    lastAckTime = millis();
+    stats.retransmits++;
+}
+
+static void sendDone() {
+    pkt[0] = XFER_EVT_DONE;
+    put32(&pkt[1], fileSize);
+    sendPacket(5);
+    doneSent = true;
+}
+
+static void handleAck(const XferCommand &cmd) {
+    if (!streaming || cmd.offset > sendOffset) return;
+
+    if (cmd.offset > ackedOffset) {
+        ackedOffset = cmd.offset;
+        lastAckTime = millis();
+    } else if (cmd.offset == ackedOffset && sendOffset > ackedOffset && sendOffset >= rewindEnd) {
+        // Duplicate ACK: the app saw a gap, go back and resend from there
+        rewind();
+    }
+
+    if (ackedOffset == fileSize) {
+        // The final ACK can beat the task's own DONE check; the app still
+        // waits for DONE
+        if (!doneSent) sendDone();
+        stats.completed++;
+        closeFile();
+        uint32_t id;
+        if (catalogIdFromPath(openPath, id)) catalogMarkUploaded(id);
+    }
+}
+
+static void handleCommand(const XferCommand &cmd) {
+    switch (cmd.op) {
+        case XFER_CMD_OPEN:
+            handleOpen(cmd);
+            break;
+        case XFER_CMD_START:
+            handleStart(cmd);
+            break;
+        case XFER_CMD_ACK:
+            handleAck(cmd);
+            break;
+        case XFER_CMD_ABORT:
+            closeFile();
+            break;
+        case XFER_INT_READY: {
+            strncpy(latestPath, cmd.path, XFER_PATH_MAX);
+            pkt[0] = XFER_EVT_READY;
+            put32(&pkt[1], cmd.offset);
+            size_t len = 5 + putPath(&pkt[5], latestPath, bleLinkMtu() - 3 - 5);
+            sendPacket(len);
+            break;
+        }
+        case XFER_INT_DISCONNECT:
+            // Keep openPath so a reconnecting app can resume with OPEN + START
+            closeFile();
+            break;
+    }
+}
+
+static void sendNextChunk() {
+    uint32_t n = fileSize - sendOffset;
+    if (n > chunkSize) n = chunkSize;
+
+    if (filePos != sendOffset) {
+        xferFile.seek(sendOffset);
+    }
+    size_t got = xferFile.read(&pkt[XFER_DATA_HEADER], n);
+    filePos = sendOffset + got;
+    if (got == 0) {
+        closeFile();
+        sendError(XFER_ERR_BAD_OFFSET);
+        return;
+    }
+
+    pkt[0] = XFER_EVT_DATA;
+    put32(&pkt[1], sendOffset);
+    sendPacket(XFER_DATA_HEADER + got);
+    sendOffset += got;
+    stats.bytesSent += got;
+    bleLinkBoost();
+}
+
+// Runs on the Bluedroid task: parse and hand off, never touch SD here
+class XferCallbacks : public BLECharacteristicCallbacks {
+    void onWrite(BLECharacteristic *pCharacteristic) {
+        const uint8_t *data = pCharacteristic->getData();
+        size_t len = pCharacteristic->getLength();
+        if (len == 0) return;
+
+        XferCommand cmd = {};
+        cmd.op = data[0];
+        if (cmd.op == XFER_CMD_OPEN) {
+            size_t n = len - 1 < XFER_PATH_MAX - 1 ? len - 1 : XFER_PATH_MAX - 1;
+            memcpy(cmd.path, &data[1], n);
+        } else if (len >= 5) {
+            cmd.offset = get32(&data[1]);
+        } else if (cmd.op != XFER_CMD_ABORT) {
+            return;
+        }
+        xQueueSend(cmdQueue, &cmd, 0);
+    }
+};
+
+static void xferTask(void *arg) {
+    XferCommand cmd;
+    for (;;) {
+        bool windowOpen = streaming && sendOffset < fileSize &&
+                          sendOffset - ackedOffset < (uint32_t)XFER_WINDOW_CHUNKS * chunkSize;
+        bool donePending = streaming && sendOffset == fileSize && !doneSent;
+        TickType_t wait = portMAX_DELAY;
+        if (streaming) {
+            wait = (windowOpen || donePending) ? 0 : pdMS_TO_TICKS(XFER_ACK_TIMEOUT_MS);
+        }
+
+        if (xQueueReceive(cmdQueue, &cmd, wait) == pdTRUE) {
+            handleCommand(cmd);
+            continue;
+        }
+        if (!streaming) continue;
+
+        if (!windowOpen) {
+            if (donePending) {
+                sendDone();
+            } else if (millis() - lastAckTime >= XFER_ACK_TIMEOUT_MS) {
+                // Lost chunks or a lost ACK
+                rewind();
+            }
+            continue;
+        }
+
+        // Alerts and a congested controller both take precedence over bulk data
+        if (bleTxLinkBusy()) {
+            vTaskDelay(pdMS_TO_TICKS(BLE_TX_CONGEST_POLL_MS));
+            continue;
+        }
+        sendNextChunk();
+    }
+}
+
+bool bleXferBegin(BLECharacteristic *xferCharacteristic) {
+    if (xferTaskHandle != NULL) return true;
+
+    cmdQueue = xQueueCreate(4, sizeof(XferCommand));
+    if (cmdQueue == NULL) return false;
+
+    xferChar = xferCharacteristic;
+    xferChar->setCallbacks(new XferCallbacks());
+
+    BaseType_t ok = xTaskCreatePinnedToCore(xferTask, "ble_xfer", XFER_TASK_STACK, NULL,
+                                            XFER_TASK_PRIORITY, &xferTaskHandle, XFER_TASK_CORE);
+    return ok == pdPASS;
+}
+
+void bleXferClipReady(const char *path) {
+    if (cmdQueue == NULL) return;
+
+    XferCommand cmd = {};
+    cmd.op = XFER_INT_READY;
+    File f = sdStorage().open(path, FILE_READ);
+    if (f) {
+        cmd.offset = f.size();
+        f.close();
+    }
+    strncpy(cmd.path, path, XFER_PATH_MAX - 1);
+    xQueueSend(cmdQueue, &cmd, 0);
+}
+
+void bleXferOnDisconnect() {
+    if (cmdQueue == NULL) return;
+
+    XferCommand cmd = {};
+    cmd.op = XFER_INT_DISCONNECT;
+    xQueueSend(cmdQueue, &cmd, 0);
+}
+
+bool bleXferActive() {
+    return streaming;
+}
+
+BleXferStats bleXferStats() {
+    return stats;
+}
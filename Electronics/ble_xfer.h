@@ -0,0 +1,75 @@
+// Recorded clip transfer over a dedicated BLE characteristic
+#pragma once
+
+#include <Arduino.h>
+#include <BLEDevice.h>
+
+#define CHARACTERISTIC_UUID_XFER "6e400004-b5a3-f393-e0a9-e50e24dcca9e"
+
+// Protocol (all integers little-endian). The app writes commands, with or
+// without response; the device answers with notifies on the same
+// characteristic.
+//
+//   App -> device
+//     XFER_CMD_OPEN   u8 op, char path[]   empty path = latest clip, or the
+//                                          oldest not yet uploaded after a reset
+//     XFER_CMD_START  u8 op, u32 offset    stream from offset (0 or resume point)
+//     XFER_CMD_ACK    u8 op, u32 offset    every byte below offset received
+//     XFER_CMD_ABORT  u8 op
+//
+//   Device -> app
+//     XFER_EVT_INFO   u8 op, u32 size, u16 chunk, u8 window, char path[]
+//     XFER_EVT_DATA   u8 op, u32 offset, payload
+//     XFER_EVT_DONE   u8 op, u32 size
+//     XFER_EVT_ERROR  u8 op, u8 code
+//     XFER_EVT_READY  u8 op, u32 size, char path[]   new clip finished
+//
+// Flow control is go-back-N: at most XFER_WINDOW_CHUNKS chunks are in flight
+// past the last ACK. A repeated ACK (the app saw a gap), or no ACK progress
+// for XFER_ACK_TIMEOUT_MS, rewinds sending to the acknowledged offset. After a
+// disconnect the app reconnects, re-OPENs the same path and STARTs from the
+// offset it already has.
+#define XFER_CMD_OPEN   0x01
+#define XFER_CMD_START  0x02
+#define XFER_CMD_ACK    0x03
+#define XFER_CMD_ABORT  0x04
+
+#define XFER_EVT_INFO   0x81
+#define XFER_EVT_DATA   0x82
+#define XFER_EVT_DONE   0x83
+#define XFER_EVT_ERROR  0x84
+#define XFER_EVT_READY  0x85
+
+#define XFER_ERR_NOT_FOUND  1
+#define XFER_ERR_NOT_OPEN   2
+#define XFER_ERR_BAD_OFFSET 3
+#define XFER_ERR_BUSY       4
+
+#define XFER_DATA_HEADER    5
+#define XFER_MAX_PAYLOAD    (517 - 3 - XFER_DATA_HEADER)
+#define XFER_WINDOW_CHUNKS  8
+#define XFER_ACK_TIMEOUT_MS 1000
+#define XFER_PATH_MAX       64
+
+#define XFER_TASK_CORE      0
+#define XFER_TASK_PRIORITY  2             // Below the alert TX task
+#define XFER_TASK_STACK     4096
+
+// Start the transfer task serving the given characteristic
+bool bleXferBegin(BLECharacteristic *xferCharacteristic);
+
+// A recording has been closed: remember it as the latest clip and tell the app
+void bleXferClipReady(const char *path);
+
+void bleXferOnDisconnect();
+
+// A clip is being streamed to the app
+bool bleXferActive();
+
+struct BleXferStats {
+    uint32_t bytesSent;
+    uint32_t retransmits;
+    uint32_t completed;
+};
+
+BleXferStats bleXferStats();
@@ -0,0 +1,83 @@
+#include "boot_sequence.h"
+#include "esp_timer.h"
+#include "app_tasks.h"
+#include "fixed_format.h"
+
+static const char *const stageNames[BOOT_STAGE_COUNT] = {"armed", "ble", "gps", "storage", "audio", "imu"};
+
+static QueueHandle_t appQueue = NULL;
+static int64_t setupUs = 0;
+static int64_t lastMarkUs = 0;        // setup() only
+static BootStep steps[BOOT_STAGE_COUNT];
+
+// Written once by the stage's owner before its event is posted
+static int64_t startUs[BOOT_STAGE_COUNT];
+static int64_t doneUs[BOOT_STAGE_COUNT];
+static volatile bool stageOk[BOOT_STAGE_COUNT] = {};
+static volatile bool stageDone[BOOT_STAGE_COUNT] = {};
+
+static void finish(BootStage stage, bool ok, int64_t started) {
+    startUs[stage] = started;
+    doneUs[stage] = esp_timer_get_time();
+    stageOk[stage] = ok;
+    stageDone[stage] = true;
+
+    // Never dropped: the controller finishes dependent work off this event
+    AppEvent event = {APP_EVT_BOOT_STAGE, doneUs[stage], stage, ok};
+    if (appQueue != NULL) xQueueSend(appQueue, &event, portMAX_DELAY);
+}
+
+static void bootTask(void *arg) {
+    BootStage stage = (BootStage)(uintptr_t)arg;
+    int64_t started = esp_timer_get_time();
+    finish(stage, steps[stage](), started);
+    vTaskDelete(NULL);
+}
+
+void bootBegin(QueueHandle_t eventQueue) {
+    appQueue = eventQueue;
+    setupUs = esp_timer_get_time();
+    lastMarkUs = setupUs;
+}
+
+void bootMark(BootStage stage, bool ok) {
+    int64_t started = lastMarkUs;
+    finish(stage, ok, started);
+    lastMarkUs = doneUs[stage];
+}
+
+bool bootStartStep(BootStage stage, BootStep step) {
+    steps[stage] = step;
+    BaseType_t ok = xTaskCreatePinnedToCore(bootTask, stageNames[stage], BOOT_TASK_STACK, (void *)(uintptr_t)stage,
+                                            BOOT_TASK_PRIORITY, NULL, BOOT_TASK_CORE);
+    if (ok == pdPASS) return true;
+    finish(stage, false, esp_timer_get_time());
+    return false;
+}
+
+bool bootStageDone(BootStage stage) {
+    return stage < BOOT_STAGE_COUNT && stageDone[stage];
+}
+
+bool bootStageOk(BootStage stage) {
+    return stage < BOOT_STAGE_COUNT && stageOk[stage];
+}
+
+bool bootComplete() {
+    for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++) {
+        if (!stageDone[i]) return false;
+    }
+    return true;
+}
+
+void bootPrintReport(Print &out) {
+    fixedLog(out, "Boot: setup() at %lu ms\n", (unsigned long)(setupUs / 1000));
+    for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++) {
+        if (!stageDone[i]) {
+            fixedLog(out, "  %-8s pending\n", stageNames[i]);
+            continue;
+        }
+        fixedLog(out, "  %-8s %-6s at %5lu ms, took %lu ms\n", stageNames[i], stageOk[i] ? "up" : "down",
+                 (unsigned long)(doneUs[i] / 1000), (unsigned long)((doneUs[i] - startUs[i]) / 1000));
+    }
+}
@@ -0,0 +1,48 @@
+// Boot sequencing - arm the triggers first, bring slow subsystems up in parallel
+#pragma once
+
+#include <Arduino.h>
+
+// setup() arms the button and the controller before any slow peripheral,
+// then BLE, then hands GPS, SD and audio (and the optional IMU) to a
+// short-lived task each. A task runs its step, records whether it came
+// up and posts APP_EVT_BOOT_STAGE (source = stage, score = 1 if up) so
+// the controller can finish work that needs more than one of them, such
+// as the recorder (SD and audio history). A slow or missing SD card no
+// longer holds up anything that doesn't write to it.
+enum BootStage : uint8_t {
+    BOOT_STAGE_ARMED,                 // Button ISR, controller and alert log live
+    BOOT_STAGE_BLE,                   // Advertising
+    BOOT_STAGE_GPS,
+    BOOT_STAGE_STORAGE,
+    BOOT_STAGE_AUDIO,
+    BOOT_STAGE_IMU,
+    BOOT_STAGE_COUNT
+};
+
+// Same core and priority as Arduino's loopTask, so peripheral interrupts
+// are allocated where setup() used to allocate them and steps never run
+// ahead of the alert path
+#define BOOT_TASK_CORE       1
+#define BOOT_TASK_PRIORITY   1
+#define BOOT_TASK_STACK      4096
+
+typedef bool (*BootStep)();
+
+// In setup() once appEventQueue exists; stage events go to the controller
+void bootBegin(QueueHandle_t eventQueue);
+
+// A stage setup() completed itself, timed from the previous mark
+void bootMark(BootStage stage, bool ok);
+
+// Run step on its own task. False (and the stage failed) if the task
+// couldn't be created.
+bool bootStartStep(BootStage stage, BootStep step);
+
+// Readiness, from any task
+bool bootStageDone(BootStage stage);
+bool bootStageOk(BootStage stage);
+bool bootComplete();
+
+// Per stage: when it finished after power-on and how long its step took
+void bootPrintReport(Print &out);
@@ -0,0 +1,317 @@
+#include "command_protocol.h"
+#include "FS.h"
+#include "sd_storage.h"
+#include "alert_frame.h"
+#include "alert_log.h"
+#include "app_config.h"
+#include "app_tasks.h"
+#include "audio_capture.h"
+#include "audio_levels.h"
+#include "ble_link.h"
+#include "ble_tx_queue.h"
+#include "ble_xfer.h"
+#include "gps_ingest.h"
+#include "heap_stats.h"
+#include "power_manager.h"
+#include "recording_catalog.h"
+#include "trace.h"
+#include "wav_recorder.h"
+#include "esp_timer.h"
+
+struct CommandRequest {
+    uint8_t len;
+    uint8_t data[CMD_MAX_REQUEST];
+};
+
+static QueueHandle_t requestQueue = NULL;
+static QueueHandle_t appQueue = NULL;
+
+// Controller task only
+static uint8_t response[BLE_TX_MAX_PAYLOAD];
+static size_t responseLen = 0;
+static size_t responseRoom = 0;
+
+static inline void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void beginResponse(uint8_t op, uint8_t seq) {
+    // One notify, less the CRC trailer
+    size_t mtuPayload = bleLinkMtu() - 3;
+    size_t limit = mtuPayload < sizeof(response) ? mtuPayload : sizeof(response);
+    responseRoom = limit - 2;
+    response[0] = (FRAME_VERSION << 4) | FRAME_KIND_RESPONSE;
+    response[1] = op | CMD_RESPONSE_BIT;
+    response[2] = seq;
+    response[3] = CMD_STATUS_OK;
+    responseLen = 4;
+}
+
+static bool fits(size_t bytes) {
+    return responseLen + bytes <= responseRoom;
+}
+
+static void put8Response(uint8_t v) {
+    response[responseLen++] = v;
+}
+
+static void put16Response(uint16_t v) {
+    put16(&response[responseLen], v);
+    responseLen += 2;
+}
+
+static void put32Response(uint32_t v) {
+    put32(&response[responseLen], v);
+    responseLen += 4;
+}
+
+static void sendResponse(uint8_t status) {
+    if (status != CMD_STATUS_OK) responseLen = 4;
+    response[3] = status;
+    put16(&response[responseLen], frameCrc16(response, responseLen));
+    bleTxEnqueue(BLE_TX_RESPONSE, response, responseLen + 2);
+}
+
+static uint8_t putConfig(const AppConfig &config) {
+    put8Response(APP_CONFIG_SCHEMA);
+    for (uint8_t key = CFG_TRIGGER_MARGIN_DB; key < CFG_KEY_END; key++) {
+        int32_t value;
+        if (!appConfigGet(config, key, value) || !fits(5)) continue;
+        put8Response(key);
+        put32Response((uint32_t)value);
+    }
+    return CMD_STATUS_OK;
+}
+
+static uint8_t handleSetConfig(const uint8_t *payload, size_t len) {
+    if (len == 0 || len % 5 != 0) return CMD_STATUS_BAD_LENGTH;
+
+    // All or nothing: validate every pair on a copy first
+    AppConfig config = appConfig();
+    for (size_t i = 0; i < len; i += 5) {
+        if (!appConfigSet(config, payload[i], (int32_t)get32(&payload[i + 1]))) {
+            return CMD_STATUS_BAD_VALUE;
+        }
+    }
+    if (!appConfigStore(config)) return CMD_STATUS_STORAGE;
+    return putConfig(config);
+}
+
+static uint8_t handleResetConfig() {
+    AppConfig defaults = APP_CONFIG_DEFAULTS;
+    if (!appConfigStore(defaults)) return CMD_STATUS_STORAGE;
+    return putConfig(defaults);
+}
+
+static uint8_t handleTestAlert() {
+    AppEvent event = {APP_EVT_TEST, esp_timer_get_time()};
+    if (xQueueSend(appQueue, &event, 0) != pdTRUE) return CMD_STATUS_BUSY;
+    return CMD_STATUS_OK;
+}
+
+static uint8_t handleListRecordings(const uint8_t *payload, size_t len) {
+    if (len != 2) return CMD_STATUS_BAD_LENGTH;
+    if (!sdStorageReady()) return CMD_STATUS_STORAGE;
+    uint16_t first = get16(payload);
+
+    // Straight from the catalog: no directory walk, so a page costs the
+    // same however many clips the card holds
+    size_t header = responseLen;
+    responseLen += 5;
+    uint16_t total = (uint16_t)catalogCount();
+    uint8_t count = 0;
+    CatalogClip clip;
+    for (size_t i = first; i < total && count < 255 && catalogAt(i, clip); i++) {
+        char path[CATALOG_CLIP_PATH_MAX];
+        catalogClipPath(clip.id, path, sizeof(path));
+        const char *name = path + 1;          // Listed without the leading '/'
+        size_t nameLen = strlen(name);
+        if (!fits(5 + nameLen)) break;
+        put32Response(clip.sizeBytes);
+        put8Response((uint8_t)nameLen);
+        memcpy(&response[responseLen], name, nameLen);
+        responseLen += nameLen;
+        count++;
+    }
+
+    put16(&response[header], total);
+    put16(&response[header + 2], first);
+    response[header + 4] = count;
+    return CMD_STATUS_OK;
+}
+
+static uint8_t handleFetchRecording(const uint8_t *payload, size_t len) {
+    if (len != 2) return CMD_STATUS_BAD_LENGTH;
+    if (!sdStorageReady()) return CMD_STATUS_STORAGE;
+    uint16_t index = get16(payload);
+
+    CatalogClip clip;
+    if (!catalogAt(index, clip)) return CMD_STATUS_NOT_FOUND;
+    char path[CATALOG_CLIP_PATH_MAX];
+    catalogClipPath(clip.id, path, sizeof(path));
+
+    size_t pathLen = strlen(path);
+    if (!fits(4 + pathLen)) return CMD_STATUS_BAD_LENGTH;
+    put32Response(clip.sizeBytes);
+    memcpy(&response[responseLen], path, pathLen);
+    responseLen += pathLen;
+    bleXferClipReady(path);
+    return CMD_STATUS_OK;
+}
+
+// Serialized CommandStats; needs a negotiated MTU above the default 23
+#define CMD_STATS_SIZE 63
+
+static uint8_t handleGetStats() {
+    if (!fits(CMD_STATS_SIZE)) return CMD_STATUS_BAD_LENGTH;
+
+    CommandStats s;
+    BleTxStats tx = bleTxStats();
+    BleXferStats xfer = bleXferStats();
+    GpsIngestStats gps = gpsIngestStats();
+    PowerReport power = powerReport();
+    float mAh = 0;
+    for (int i = 0; i < POWER_STATE_COUNT; i++) mAh += power.state[i].mAh;
+
+    s.uptimeS = (uint32_t)(esp_timer_get_time() / 1000000);
+    s.bleSent = tx.sent;
+    s.bleDropped = tx.dropped;
+    s.bleNotifyErrors = tx.notifyErrors + tx.oversized;
+    s.xferBytes = xfer.bytesSent;
+    s.xferCompleted = xfer.completed;
+    s.gpsBytes = gps.bytes;
+    s.gpsSentences = gps.sentencesPassed + gps.pvtFrames;
+    s.recorderDropped = wavRecorderDroppedChunks();
+    s.noiseFloorDbX10 = (int16_t)lroundf(audioNoiseFloorDb() * 10.0f);
+    s.energyMahX100 = (uint32_t)lroundf(mAh * 100.0f);
+    HeapStats heap = heapStatsSample();
+    s.freeHeap = heap.freeBytes;
+    s.alertsPending = alertLogStats().pending;
+    s.minFreeHeap = heap.minFreeBytes;
+    s.largestFreeBlock = heap.largestBlock;
+    s.heapFragmentationPct = heap.fragmentationPct;
+    s.alertHeapBlocks = (int16_t)heapAlertDelta().lastBlocks;
+    s.audioDroppedFrames = audioCaptureDroppedFrames();
+
+    put32Response(s.uptimeS);
+    put32Response(s.bleSent);
+    put32Response(s.bleDropped);
+    put32Response(s.bleNotifyErrors);
+    put32Response(s.xferBytes);
+    put32Response(s.xferCompleted);
+    put32Response(s.gpsBytes);
+    put32Response(s.gpsSentences);
+    put32Response(s.recorderDropped);
+    put16Response((uint16_t)s.noiseFloorDbX10);
+    put32Response(s.energyMahX100);
+    put32Response(s.freeHeap);
+    put16Response(s.alertsPending);
+    put32Response(s.minFreeHeap);
+    put32Response(s.largestFreeBlock);
+    put8Response(s.heapFragmentationPct);
+    put16Response((uint16_t)s.alertHeapBlocks);
+    put32Response(s.audioDroppedFrames);
+    return CMD_STATUS_OK;
+}
+
+static uint8_t handleAckAlert(const uint8_t *payload, size_t len) {
+    if (len != 2) return CMD_STATUS_BAD_LENGTH;
+    alertLogAck(get16(payload));
+    put16Response(alertLogStats().pending);
+    return CMD_STATUS_OK;
+}
+
+static uint8_t handleGetTrace(const uint8_t *payload, size_t len) {
+    if (len != 2) return CMD_STATUS_BAD_LENGTH;
+    uint16_t first = get16(payload);
+    if (!fits(5 + sizeof(TraceRecord))) return CMD_STATUS_BAD_LENGTH;
+    if (first == 0) traceFreeze(true);
+
+    TraceRecord *records = (TraceRecord *)&response[responseLen + 5];
+    size_t room = (responseRoom - responseLen - 5) / sizeof(TraceRecord);
+    uint16_t total = 0;
+    size_t count = traceRead(first, records, room > 255 ? 255 : room, &total);
+    if (first + count >= total) traceFreeze(false);
+
+    put16Response(total);
+    put16Response(first);
+    put8Response((uint8_t)count);
+    responseLen += count * sizeof(TraceRecord);
+    return CMD_STATUS_OK;
+}
+
+static void handleRequest(const CommandRequest &req) {
+    if (req.len < 2) return;                 // No sequence number to answer with
+    uint8_t op = req.data[0];
+    const uint8_t *payload = &req.data[2];
+    size_t len = req.len - 2;
+
+    beginResponse(op, req.data[1]);
+    uint8_t status;
+    switch (op) {
+        case CMD_GET_CONFIG:
+            status = len == 0 ? putConfig(appConfig()) : CMD_STATUS_BAD_LENGTH;
+            break;
+        case CMD_SET_CONFIG:      status = handleSetConfig(payload, len); break;
+        case CMD_RESET_CONFIG:    status = handleResetConfig(); break;
+        case CMD_TEST_ALERT:      status = handleTestAlert(); break;
+        case CMD_LIST_RECORDINGS: status = handleListRecordings(payload, len); break;
+        case CMD_FETCH_RECORDING: status = handleFetchRecording(payload, len); break;
+        case CMD_GET_STATS:       status = handleGetStats(); break;
+        case CMD_ACK_ALERT:       status = handleAckAlert(payload, len); break;
+        case CMD_GET_TRACE:       status = handleGetTrace(payload, len); break;
+        default:                  status = CMD_STATUS_UNKNOWN_OP; break;
+    }
+    sendResponse(status);
+}
+
+bool commandBegin(QueueHandle_t eventQueue) {
+    appQueue = eventQueue;
+    requestQueue = xQueueCreate(CMD_QUEUE_DEPTH, sizeof(CommandRequest));
+    return requestQueue != NULL;
+}
+
+void commandOnWrite(const uint8_t *data, size_t len) {
+    if (requestQueue == NULL || len == 0) return;
+
+    CommandRequest req;
+    req.len = len > CMD_MAX_REQUEST ? CMD_MAX_REQUEST : (uint8_t)len;
+    memcpy(req.data, data, req.len);
+    if (len > CMD_MAX_REQUEST || xQueueSend(requestQueue, &req, 0) != pdTRUE) {
+        // Answer straight away; the controller may be the one that's stuck
+        if (len >= 2) {
+            uint8_t reply[6] = {(FRAME_VERSION << 4) | FRAME_KIND_RESPONSE,
+                                (uint8_t)(data[0] | CMD_RESPONSE_BIT), data[1],
+                                len > CMD_MAX_REQUEST ? CMD_STATUS_BAD_LENGTH : CMD_STATUS_BUSY};
+            put16(&reply[4], frameCrc16(reply, 4));
+            bleTxEnqueue(BLE_TX_RESPONSE, reply, sizeof(reply));
+        }
+        return;
+    }
+
+    AppEvent event = {APP_EVT_COMMAND, esp_timer_get_time()};
+    xQueueSend(appQueue, &event, 0);
+}
+
+void commandProcess() {
+    CommandRequest req;
+    while (xQueueReceive(requestQueue, &req, 0) == pdTRUE) {
+        handleRequest(req);
+    }
+}
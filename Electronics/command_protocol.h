@@ -0,0 +1,95 @@
+// Binary command/response protocol on the RX characteristic
+#pragma once
+
+#include <Arduino.h>
+
+// Requests are written to RX (all integers little-endian):
+//   0  u8   opcode
+//   1  u8   sequence, echoed in the response
+//   2  ...  payload
+//
+// Responses are TX frames of FRAME_KIND_RESPONSE (see alert_frame.h), so
+// they share the version byte and CRC trailer with alerts:
+//   0  u8   version << 4 | FRAME_KIND_RESPONSE
+//   1  u8   opcode | CMD_RESPONSE_BIT
+//   2  u8   sequence
+//   3  u8   CMD_STATUS_*
+//   4  ...  payload
+//   n  u16  CRC
+//
+//   CMD_GET_CONFIG     -                -> u8 schema, {u8 key, i32 value} x all keys
+//   CMD_SET_CONFIG     {u8 key, i32}... -> as CMD_GET_CONFIG; applied and saved to
+//                                          NVS only if every pair is valid
+//   CMD_RESET_CONFIG   -                -> as CMD_GET_CONFIG, back to defaults
+//   CMD_TEST_ALERT     -                -> -; an alert frame of type ALERT_FRAME_TEST follows
+//   CMD_LIST_RECORDINGS u16 first       -> u16 total, u16 first, u8 count,
+//                                          {u32 size, u8 len, char name[len]} x count
+//   CMD_FETCH_RECORDING u16 index       -> u32 size, char path[]; the clip becomes the
+//                                          transfer's latest, so XFER_CMD_OPEN with an
+//                                          empty path fetches it (see ble_xfer.h)
+//   CMD_GET_STATS      -                -> CommandStats fields in order
+//   CMD_ACK_ALERT      u16 seq          -> u16 alerts still pending; the alert
+//                                          with seq is delivered (see alert_log.h)
+//   CMD_GET_TRACE      u16 first        -> u16 total, u16 first, u8 count,
+//                                          {TraceRecord} x count (see trace.h);
+//                                          first 0 freezes the trace until the
+//                                          last page has been read
+//
+// Recordings are numbered oldest first from the recording catalog (see
+// recording_catalog.h); list until first + count reaches total. Indexes
+// shift down as the oldest clips are pruned. Entries that don't fit in one
+// notify are left for the next request.
+#define CMD_GET_CONFIG       0x01
+#define CMD_SET_CONFIG       0x02
+#define CMD_RESET_CONFIG     0x03
+#define CMD_TEST_ALERT       0x04
+#define CMD_LIST_RECORDINGS  0x05
+#define CMD_FETCH_RECORDING  0x06
+#define CMD_GET_STATS        0x07
+#define CMD_ACK_ALERT        0x08
+#define CMD_GET_TRACE        0x09
+
+#define CMD_RESPONSE_BIT     0x80
+
+#define CMD_STATUS_OK          0
+#define CMD_STATUS_UNKNOWN_OP  1
+#define CMD_STATUS_BAD_LENGTH  2
+#define CMD_STATUS_BAD_VALUE   3    // Unknown config key or value out of range
+#define CMD_STATUS_NOT_FOUND   4
+#define CMD_STATUS_STORAGE     5    // SD unavailable or NVS write failed
+#define CMD_STATUS_BUSY        6    // Command queue full
+
+#define CMD_MAX_REQUEST      64
+#define CMD_QUEUE_DEPTH      4
+
+// CMD_GET_STATS payload, serialized field by field
+struct CommandStats {
+    uint32_t uptimeS;
+    uint32_t bleSent;
+    uint32_t bleDropped;
+    uint32_t bleNotifyErrors;
+    uint32_t xferBytes;
+    uint32_t xferCompleted;
+    uint32_t gpsBytes;
+    uint32_t gpsSentences;            // NMEA passed plus NAV-PVT decoded
+    uint32_t recorderDropped;
+    int16_t noiseFloorDbX10;
+    uint32_t energyMahX100;           // Power model estimate since boot
+    uint32_t freeHeap;
+    uint16_t alertsPending;           // Logged alerts not yet acked
+    uint32_t minFreeHeap;             // Low-water mark since boot
+    uint32_t largestFreeBlock;
+    uint8_t heapFragmentationPct;
+    int16_t alertHeapBlocks;          // Net heap blocks held after the last alert
+    uint32_t audioDroppedFrames;      // Capture ring overruns: the detector fell behind
+};
+
+// eventQueue is the controller's appEventQueue: writes are queued here
+// and announced with APP_EVT_COMMAND, test alerts become APP_EVT_TEST.
+bool commandBegin(QueueHandle_t eventQueue);
+
+// RX characteristic onWrite (Bluedroid task): copy and hand off, never blocks
+void commandOnWrite(const uint8_t *data, size_t len);
+
+// Controller task, on APP_EVT_COMMAND: run every queued request
+void commandProcess();
@@ -0,0 +1,170 @@
+#include "dsp_kernels.h"
+#include <math.h>
+
+static inline int32_t saturate16(int32_t v) {
+    return v > 32767 ? 32767 : (v < -32768 ? -32768 : v);
+}
+
+static void peakRangeScalar(const int16_t *samples, size_t count, int32_t &maxv, int32_t &minv) {
+    for (size_t i = 0; i < count; i++) {
+        int32_t s = samples[i];
+        maxv = s > maxv ? s : maxv;
+        minv = s < minv ? s : minv;
+    }
+}
+
+#if DSP_ENABLE_PIE
+// Running max/min across 8 lanes; blocks is the number of 16-byte vectors.
+// q1/q2 hold the lane-wise max/min and are spilled to lanes[0..7]/[8..15].
+static void peakRangePie(const int16_t *samples, size_t blocks, int32_t &maxv, int32_t &minv) {
+    alignas(DSP_VECTOR_ALIGN) int16_t lanes[16];
+    const int16_t *src = samples;
+    int16_t *dst = lanes;
+    asm volatile(
+        "ee.zero.q     q1\n"
+        "ee.zero.q     q2\n"
+        "loopnez       %[blocks], 1f\n"
+        "ee.vld.128.ip q0, %[src], 16\n"
+        "ee.vmax.s16   q1, q1, q0\n"
+        "ee.vmin.s16   q2, q2, q0\n"
+        "1:\n"
+        "ee.vst.128.ip q1, %[dst], 16\n"
+        "ee.vst.128.ip q2, %[dst], 16\n"
+        : [src] "+r"(src), [dst] "+r"(dst)
+        : [blocks] "r"(blocks)
+        : "memory");
+    for (int i = 0; i < 8; i++) {
+        maxv = lanes[i] > maxv ? lanes[i] : maxv;
+        minv = lanes[i + 8] < minv ? lanes[i + 8] : minv;
+    }
+}
+#endif
+
+int16_t dspPeakAbs(const int16_t *samples, size_t count) {
+    int32_t maxv = 0;
+    int32_t minv = 0;
+
+#if DSP_ENABLE_PIE
+    // Scalar head up to the first aligned vector, PIE body, scalar tail
+    size_t head = ((DSP_VECTOR_ALIGN - ((uintptr_t)samples & (DSP_VECTOR_ALIGN - 1))) &
+                   (DSP_VECTOR_ALIGN - 1)) / sizeof(int16_t);
+    if (head > count) head = count;
+    peakRangeScalar(samples, head, maxv, minv);
+    samples += head;
+    count -= head;
+
+    size_t blocks = count / 8;
+    if (blocks > 0) {
+        peakRangePie(samples, blocks, maxv, minv);
+        samples += blocks * 8;
+        count -= blocks * 8;
+    }
+#endif
+
+    peakRangeScalar(samples, count, maxv, minv);
+    return (int16_t)saturate16(maxv > -minv ? maxv : -minv);
+}
+
+float dspRms(const int16_t *samples, size_t count) {
+    if (count == 0) return 0.0f;
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        int32_t s = samples[i];
+        total += (uint32_t)(s * s);
+    }
+    return sqrtf((float)total / (float)count);
+}
+
+void dspGainSaturate(int16_t *samples, size_t count, int32_t gain) {
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = (int16_t)saturate16(samples[i] * gain);
+    }
+}
+
+void dspNoiseGate(int16_t *samples, size_t count, int16_t threshold) {
+    for (size_t i = 0; i < count; i++) {
+        int32_t s = samples[i];
+        int32_t a = s < 0 ? -s : s;
+        samples[i] = a < threshold ? 0 : (int16_t)s;
+    }
+}
+
+void dspGateAndGain(int16_t *samples, size_t count, int16_t threshold, int32_t gain) {
+    for (size_t i = 0; i < count; i++) {
+        int32_t s = samples[i];
+        int32_t a = s < 0 ? -s : s;
+        int32_t y = saturate16(s * gain);
+        samples[i] = a < threshold ? 0 : (int16_t)y;
+    }
+}
+
+void dspAgcInit(DspAgc &agc, int16_t targetPeak, int32_t maxGain) {
+    agc.maxGainQ8 = maxGain << 8;
+    agc.gainQ8 = agc.maxGainQ8;
+    agc.envelope = 0;
+    agc.targetPeak = targetPeak;
+}
+
+void dspAgcProcess(DspAgc &agc, int16_t *samples, size_t count) {
+    for (size_t start = 0; start < count; start += DSP_AGC_BLOCK) {
+        int16_t *block = samples + start;
+        int32_t n = (int32_t)(count - start < DSP_AGC_BLOCK ? count - start : DSP_AGC_BLOCK);
+
+        agc.envelope -= agc.envelope >> DSP_AGC_RELEASE_SHIFT;
+        int32_t peak = dspPeakAbs(block, n);
+        if (peak > agc.envelope) agc.envelope = peak;
+
+        int32_t target = agc.envelope > 0 ? (agc.targetPeak << 8) / agc.envelope : agc.maxGainQ8;
+        if (target > agc.maxGainQ8) target = agc.maxGainQ8;
+        if (target < DSP_AGC_MIN_GAIN_Q8) target = DSP_AGC_MIN_GAIN_Q8;
+
+        // The envelope already covers this block, so a falling gain applies
+        // to all of it; a rising one ramps across it
+        int32_t from = agc.gainQ8 < target ? agc.gainQ8 : target;
+        int32_t step = target - from;
+        for (int32_t i = 0; i < n; i++) {
+            int32_t g = from + step * i / n;
+            block[i] = (int16_t)saturate16((block[i] * g) >> 8);
+        }
+        agc.gainQ8 = target;
+    }
+}
+
+#ifdef DSP_BENCHMARK
+#include <Arduino.h>
+
+static void benchKernel(Print &out, const char *name, int16_t *buf, size_t count, int kernel) {
+    const int runs = 16;
+    volatile int32_t sink = 0;
+    uint32_t start = ESP.getCycleCount();
+    for (int r = 0; r < runs; r++) {
+        switch (kernel) {
+            case 0: sink += dspPeakAbs(buf, count); break;
+            case 1: sink += (int32_t)dspRms(buf, count); break;
+            case 2: dspGainSaturate(buf, count, 1); break;
+            case 3: dspNoiseGate(buf, count, 0); break;
+            case 4: dspGateAndGain(buf, count, 0, 1); break;
+        }
+    }
+    uint32_t cycles = ESP.getCycleCount() - start;
+    out.printf("  %-14s %5u samples: %.2f cycles/sample\n", name, (unsigned)count,
+               (double)cycles / ((double)runs * count));
+}
+
+void dspBenchmark(Print &out) {
+    // One 50ms monitor frame and one 4KB recording chunk
+    static const size_t sizes[] = {800, 2048};
+    static const char *names[] = {"peak", "rms", "gain", "gate", "gate+gain"};
+    alignas(DSP_VECTOR_ALIGN) static int16_t buf[2048];
+    for (size_t i = 0; i < 2048; i++) {
+        buf[i] = (int16_t)((i * 7919) & 0x3fff) - 0x2000;
+    }
+
+    out.printf("DSP kernel benchmark (PIE %s)\n", DSP_ENABLE_PIE ? "on" : "off");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (int k = 0; k < 5; k++) {
+            benchKernel(out, names[k], buf, sizes[s], k);
+        }
+    }
+}
+#endif
@@ -0,0 +1,61 @@
+// Sample-level DSP kernels shared by the monitor and recording paths
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// On the ESP32-S3 the peak kernel runs on the PIE 128-bit vector unit
+// (8 x int16 per instruction) when the buffer is 16-byte aligned; everything
+// else, and any unaligned head/tail, uses the scalar code. Build with
+// -DDSP_ENABLE_PIE=0 to force the scalar path.
+#ifndef DSP_ENABLE_PIE
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+#define DSP_ENABLE_PIE 1
+#else
+#define DSP_ENABLE_PIE 0
+#endif
+#endif
+
+#define DSP_VECTOR_ALIGN 16
+
+// Largest |sample|, saturated to 32767 so a full-scale negative sample
+// does not wrap
+int16_t dspPeakAbs(const int16_t *samples, size_t count);
+
+// Root mean square level of the block
+float dspRms(const int16_t *samples, size_t count);
+
+// In-place multiply with saturation to the int16 range
+void dspGainSaturate(int16_t *samples, size_t count, int32_t gain);
+
+// In-place zeroing of every sample with |x| < threshold
+void dspNoiseGate(int16_t *samples, size_t count, int16_t threshold);
+
+// Noise gate followed by gain in a single pass (the recording path)
+void dspGateAndGain(int16_t *samples, size_t count, int16_t threshold, int32_t gain);
+
+// Recording-path automatic gain control. Each DSP_AGC_BLOCK samples the
+// block peak is folded into a peak envelope first, so the gain is already
+// down before the loud samples are scaled (a 2 ms look-ahead limiter).
+// Gain falls at once and rises along the envelope release, ~0.5 s.
+#define DSP_AGC_BLOCK         32
+#define DSP_AGC_RELEASE_SHIFT 8       // Envelope decays by 1/256 per block
+#define DSP_AGC_MIN_GAIN_Q8   64      // 0.25
+
+struct DspAgc {
+    int32_t gainQ8;                   // Gain applied at the end of the last block, Q8
+    int32_t envelope;                 // Peak envelope of the input
+    int32_t targetPeak;               // Output peak the envelope is scaled to
+    int32_t maxGainQ8;
+};
+
+void dspAgcInit(DspAgc &agc, int16_t targetPeak, int32_t maxGain);
+
+// In-place AGC; state carries over between calls of any length
+void dspAgcProcess(DspAgc &agc, int16_t *samples, size_t count);
+
+#ifdef DSP_BENCHMARK
+class Print;
+// Cycles per sample for each kernel at monitor-frame and record-chunk sizes
+void dspBenchmark(Print &out);
+#endif
@@ -0,0 +1,18 @@
+#include "fixed_format.h"
+
+static volatile bool held = false;
+
+void fixedLogHold(bool hold) {
+    held = hold;
+}
+
+void fixedLog(Print &out, const char *fmt, ...) {
+    if (held) return;
+    char line[FIXED_LOG_LINE];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (n <= 0) return;
+    out.write((const uint8_t *)line, (size_t)n < sizeof(line) ? n : sizeof(line) - 1);
+}
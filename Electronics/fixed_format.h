@@ -0,0 +1,22 @@
+// Heap-free formatting for the alert path: a fixed buffer that truncates
+// instead of growing. Arduino String and Print::printf both reach for the
+// heap (printf once a line passes 64 bytes).
+#pragma once
+
+#include <stdarg.h>
+#include <stdio.h>
+#include "platform.h"
+
+// Longest line fixedLog() prints in one piece; the buffer is on the
+// caller's stack
+#define FIXED_LOG_LINE 160
+
+// Print::printf without the heap fallback; longer lines are cut at
+// FIXED_LOG_LINE - 1 characters. Lines are dropped while the console is
+// held. Each line is one write, so lines from different tasks don't split.
+void fixedLog(Print &out, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Hold the console for binary output such as the serial trace dump. Only
+// fixedLog() honours this, so anything printing off the controller task
+// goes through fixedLog().
+void fixedLogHold(bool held);
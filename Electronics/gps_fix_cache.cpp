@@ -0,0 +1,127 @@
+#include "gps_fix_cache.h"
+#include <math.h>
+#include <sys/time.h>
+#include "alert_frame.h"
+
+#define FIX_CACHE_MAGIC 0x46495831u   // "FIX1"
+#define EARTH_RADIUS_M  6371000.0
+
+// RTC slow memory keeps its contents through deep sleep and soft resets.
+// The system clock (gettimeofday) is also kept across deep sleep, so the
+// capture time below stays meaningful after waking.
+struct FixRecord {
+    uint32_t magic;
+    GpsFix fix;
+    int64_t capturedUs;               // System clock when the fix was taken
+};
+
+RTC_DATA_ATTR static FixRecord cache;
+RTC_DATA_ATTR static bool clockSynced;
+static int64_t lastConfirmUs = 0;     // System clock when GPS time last agreed
+
+static int64_t clockNowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// u-blox time is UTC; keep the system clock on it. When the clock steps the
+// cache's capture time moves with it so the fix age stays right.
+void gpsClockSet(int64_t gpsNowUs) {
+    int64_t nowUs = clockNowUs();
+    int64_t delta = gpsNowUs - nowUs;
+    if (!clockSynced || llabs(delta) >= (int64_t)GPS_CLOCK_SYNC_TOLERANCE_S * 1000000) {
+        struct timeval tv;
+        tv.tv_sec = (time_t)(gpsNowUs / 1000000);
+        tv.tv_usec = (suseconds_t)(gpsNowUs % 1000000);
+        settimeofday(&tv, NULL);
+        if (cache.magic == FIX_CACHE_MAGIC) {
+            cache.capturedUs += delta;
+        }
+        clockSynced = true;
+        nowUs = gpsNowUs;
+    }
+    lastConfirmUs = nowUs;
+}
+
+static void syncClock(TinyGPSPlus &gps) {
+    if (!gps.date.isValid() || !gps.time.isValid() || gps.date.year() < 2020) return;
+
+    uint32_t gpsUtc = frameUtcSeconds(gps.date.year(), gps.date.month(), gps.date.day(),
+                                      gps.time.hour(), gps.time.minute(), gps.time.second());
+    // The time fields were latched age() ms ago
+    gpsClockSet((int64_t)gpsUtc * 1000000 + gps.time.centisecond() * 10000 +
+                (int64_t)gps.time.age() * 1000);
+}
+
+void gpsFixCacheStore(const GpsFix &fix, uint32_t ageMs) {
+    cache.fix = fix;
+    cache.capturedUs = clockNowUs() - (int64_t)ageMs * 1000;
+    cache.magic = FIX_CACHE_MAGIC;
+}
+
+void gpsFixCacheUpdate(TinyGPSPlus &gps) {
+    syncClock(gps);
+
+    if (!gps.location.isUpdated() || !gps.location.isValid()) return;
+    if (!gps.hdop.isValid() || !gps.satellites.isValid()) return;
+
+    // TinyGPS++ reports HDOP in hundredths
+    int32_t hdop = gps.hdop.value() / 10;
+    uint32_t sats = gps.satellites.value();
+    if (hdop > GPS_FIX_MAX_HDOP_X10 || sats < GPS_FIX_MIN_SATS) return;
+
+    GpsFix fix;
+    fix.lat_e7 = (int32_t)lround(gps.location.lat() * 1e7);
+    fix.lng_e7 = (int32_t)lround(gps.location.lng() * 1e7);
+    fix.utc = (gps.date.isValid() && gps.time.isValid())
+                  ? frameUtcSeconds(gps.date.year(), gps.date.month(), gps.date.day(),
+                                    gps.time.hour(), gps.time.minute(), gps.time.second())
+                  : 0;
+    fix.hdop_x10 = (uint8_t)hdop;
+    fix.sats = sats > 255 ? 255 : (uint8_t)sats;
+    fix.accM = 0;                     // NMEA GGA/RMC carry no accuracy estimate
+    fix.speedMps = gps.speed.isValid() ? (float)gps.speed.mps() : -1.0f;
+    fix.courseDeg = gps.course.isValid() ? (float)gps.course.deg() : 0.0f;
+    gpsFixCacheStore(fix, gps.location.age());
+}
+
+// Flat-earth step along the course; fine over the few hundred metres the
+// horizon allows
+static void deadReckon(GpsFix &fix, float seconds) {
+    double distance = fix.speedMps * seconds;
+    double course = fix.courseDeg * M_PI / 180.0;
+    double lat = fix.lat_e7 / 1e7;
+    double dLat = distance * cos(course) / EARTH_RADIUS_M;
+    double dLng = distance * sin(course) / (EARTH_RADIUS_M * cos(lat * M_PI / 180.0));
+    fix.lat_e7 += (int32_t)lround(dLat * 180.0 / M_PI * 1e7);
+    fix.lng_e7 += (int32_t)lround(dLng * 180.0 / M_PI * 1e7);
+}
+
+bool gpsFixCacheEstimate(GpsPosition &position) {
+    if (cache.magic != FIX_CACHE_MAGIC) return false;
+
+    int64_t ageUs = clockNowUs() - cache.capturedUs;
+    if (ageUs < 0) ageUs = 0;
+    position.fix = cache.fix;
+    position.ageMs = ageUs / 1000 > UINT32_MAX ? UINT32_MAX : (uint32_t)(ageUs / 1000);
+    position.fresh = position.ageMs < GPS_FIX_FRESH_MS;
+    position.deadReckoned = false;
+
+    float ageS = position.ageMs / 1000.0f;
+    if (!position.fresh && position.fix.speedMps >= GPS_DR_MIN_SPEED_MPS && ageS <= GPS_DR_MAX_AGE_S) {
+        deadReckon(position.fix, ageS);
+        position.deadReckoned = true;
+    }
+    return true;
+}
+
+uint32_t gpsClockUtcNow() {
+    if (!clockSynced) return 0;
+    return (uint32_t)(clockNowUs() / 1000000);
+}
+
+bool gpsClockFresh() {
+    return clockSynced && lastConfirmUs != 0 &&
+           clockNowUs() - lastConfirmUs < (int64_t)GPS_FIX_FRESH_MS * 1000;
+}
@@ -0,0 +1,62 @@
+// Last-known-good GPS fix, kept in RTC memory so it survives deep sleep
+#pragma once
+
+#include <Arduino.h>
+#include <TinyGPS++.h>
+
+// A fix is cached only when it is this good
+#define GPS_FIX_MAX_HDOP_X10   50     // HDOP 5.0
+#define GPS_FIX_MIN_SATS       4
+
+// Younger than this counts as a current fix (GPS fixes arrive at 1 Hz)
+#define GPS_FIX_FRESH_MS       2000
+
+// Dead reckoning from the cached speed/course: only from a moving fix, and
+// never further out than this. Past the horizon the cached position is
+// reported as-is.
+#define GPS_DR_MIN_SPEED_MPS   0.5f
+#define GPS_DR_MAX_AGE_S       30
+
+// System clock is resynced from GPS when it drifts further than this
+#define GPS_CLOCK_SYNC_TOLERANCE_S 2
+
+struct GpsFix {
+    int32_t lat_e7;
+    int32_t lng_e7;
+    uint32_t utc;                     // GPS time of the fix, 0 if it had none
+    uint8_t hdop_x10;                 // HDOP (NMEA) or PDOP (UBX) * 10
+    uint8_t sats;
+    uint8_t accM;                     // Horizontal accuracy estimate in metres, 0 = unknown
+    float speedMps;                   // < 0 when not reported
+    float courseDeg;
+};
+
+// Position estimate for an alert
+struct GpsPosition {
+    GpsFix fix;                       // lat/lng possibly advanced by dead reckoning
+    uint32_t ageMs;                   // Since the fix was taken
+    bool fresh;                       // ageMs < GPS_FIX_FRESH_MS
+    bool deadReckoned;
+};
+
+// Offer the parser state after a sentence has been decoded. Caches the fix
+// when the location was just updated and passes the quality gates, and sets
+// the system clock from GPS time. Call with gpsMutex held.
+void gpsFixCacheUpdate(TinyGPSPlus &gps);
+
+// Protocol-neutral entry points (the UBX path): store a fix that has already
+// passed the quality gates, taken ageMs ago, and report the current GPS UTC
+// time in microseconds. Call with gpsMutex held.
+void gpsFixCacheStore(const GpsFix &fix, uint32_t ageMs);
+void gpsClockSet(int64_t gpsNowUs);
+
+// Best position available now: false if no fix has ever been cached (since
+// power-on). Call with gpsMutex held.
+bool gpsFixCacheEstimate(GpsPosition &position);
+
+// Current UTC seconds from the system clock once it has been set from GPS
+// (survives deep sleep), 0 before that
+uint32_t gpsClockUtcNow();
+
+// True while GPS time has confirmed the clock within GPS_FIX_FRESH_MS
+bool gpsClockFresh();
@@ -0,0 +1,352 @@
+#include "gps_ingest.h"
+#include "gps_fix_cache.h"
+#include "alert_frame.h"
+#include "ubx_protocol.h"
+
+// Standard NMEA outputs we don't parse: GLL, GSA, GSV, VTG, plus GRS/GST/ZDA
+// in case an earlier configuration enabled them
+static const uint8_t unusedNmea[] = {0x01, 0x02, 0x03, 0x05, 0x06, 0x07, 0x08};
+#define NMEA_GGA 0x00
+#define NMEA_RMC 0x04
+
+static HardwareSerial *gpsPort = nullptr;
+static TinyGPSPlus *gpsParser = nullptr;
+static SemaphoreHandle_t parserMutex = NULL;
+static TaskHandle_t gpsTaskHandle = NULL;
+static GpsIngestStats stats = {};
+static GpsProtocol gpsProtocol = GPS_PROTOCOL_NMEA;
+static volatile uint32_t boostUntil = 0;
+static volatile bool backupRequested = false;
+static volatile GpsPowerState powerApplied = GPS_POWER_SAVE;
+
+// Task-owned sentence assembly
+static char line[GPS_NMEA_MAX];
+static size_t lineLen = 0;
+static bool lineOverlong = false;
+
+// Task-owned UBX frame assembly
+enum UbxState { UBX_SYNC_1, UBX_SYNC_2, UBX_HEADER, UBX_PAYLOAD, UBX_CHECKSUM };
+static UbxState ubxState = UBX_SYNC_1;
+static uint8_t ubxHeader[4];                  // class, id, u16 length
+alignas(4) static uint8_t ubxPayload[UBX_MAX_PAYLOAD];
+static uint16_t ubxLen = 0;
+static uint16_t ubxPos = 0;
+static uint8_t ubxCkA = 0;
+static uint8_t ubxCkB = 0;
+static uint8_t ubxRxCk[2];
+
+static void sendPacket(const uint8_t *packet, size_t len) {
+    gpsPort->write(packet, len);
+}
+
+// CFG-PRT: UART1 to 115200 8N1, UBX+NMEA in and out
+static void changeBaudrate() {
+    const uint8_t packet[] = {
+        0xB5, 0x62, 0x06, 0x00, 0x14, 0x00, 0x01, 0x00, 0x00, 0x00, 0xD0, 0x08, 0x00, 0x00,
+        0x00, 0xC2, 0x01, 0x00, 0x07, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x7E
+    };
+    sendPacket(packet, sizeof(packet));
+}
+
+static void ubxSend(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len) {
+    uint8_t header[6] = {0xB5, 0x62, cls, id, (uint8_t)len, (uint8_t)(len >> 8)};
+    uint8_t ckA = 0, ckB = 0;
+    for (int i = 2; i < 6; i++) {
+        ckA += header[i];
+        ckB += ckA;
+    }
+    for (uint16_t i = 0; i < len; i++) {
+        ckA += payload[i];
+        ckB += ckA;
+    }
+    uint8_t checksum[2] = {ckA, ckB};
+    sendPacket(header, sizeof(header));
+    sendPacket(payload, len);
+    sendPacket(checksum, sizeof(checksum));
+}
+
+// CFG-MSG, short form: rate on the port the command arrives on
+static void setNmeaRate(uint8_t msgId, uint8_t rate) {
+    const uint8_t payload[3] = {UBX_CLASS_NMEA, msgId, rate};
+    ubxSend(UBX_CLASS_CFG, UBX_CFG_MSG, payload, sizeof(payload));
+}
+
+static void setUbxRate(uint8_t cls, uint8_t id, uint8_t rate) {
+    const uint8_t payload[3] = {cls, id, rate};
+    ubxSend(UBX_CLASS_CFG, UBX_CFG_MSG, payload, sizeof(payload));
+}
+
+// Output message selection for the protocol in use
+static void configureMessages() {
+    bool nmea = (gpsProtocol == GPS_PROTOCOL_NMEA);
+    for (size_t i = 0; i < sizeof(unusedNmea); i++) {
+        setNmeaRate(unusedNmea[i], 0);
+    }
+    setNmeaRate(NMEA_GGA, nmea ? 1 : 0);
+    setNmeaRate(NMEA_RMC, nmea ? 1 : 0);
+    setUbxRate(UBX_CLASS_NAV, UBX_NAV_PVT, nmea ? 0 : 1);
+}
+
+// CFG-RATE measurement period plus CFG-RXM power mode. Power save needs a
+// GPS-only (or GPS+QZSS) constellation setup on M8 receivers; others NAK it
+// and stay continuous, which is harmless.
+static void applyMode(bool boost) {
+    uint16_t rateMs = boost ? GPS_RATE_BOOST_MS : GPS_RATE_IDLE_MS;
+    const uint8_t rate[6] = {(uint8_t)rateMs, (uint8_t)(rateMs >> 8), 0x01, 0x00, 0x01, 0x00};
+    ubxSend(UBX_CLASS_CFG, UBX_CFG_RATE, rate, sizeof(rate));
+    const uint8_t rxm[2] = {0x08, boost ? UBX_RXM_CONTINUOUS : UBX_RXM_POWER_SAVE};
+    ubxSend(UBX_CLASS_CFG, UBX_CFG_RXM, rxm, sizeof(rxm));
+}
+
+// RXM-PMREQ: indefinite backup, woken by the next byte we send
+static void enterBackup() {
+    const uint8_t payload[16] = {
+        0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,                      // duration 0 = until woken
+        UBX_PMREQ_FLAG_BACKUP, 0x00, 0x00, 0x00,
+        UBX_PMREQ_WAKE_UART_RX, 0x00, 0x00, 0x00
+    };
+    ubxSend(UBX_CLASS_RXM, UBX_RXM_PMREQ, payload, sizeof(payload));
+}
+
+// Configuration lives in receiver RAM and may not survive backup, so it is
+// all sent again after waking
+static void leaveBackup() {
+    const uint8_t wake[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    sendPacket(wake, sizeof(wake));
+    vTaskDelay(pdMS_TO_TICKS(UBX_WAKE_SETTLE_MS));
+    configureMessages();
+}
+
+static void applyPowerState(GpsPowerState state) {
+    if (powerApplied == GPS_POWER_BACKUP) {
+        leaveBackup();
+    }
+    if (state == GPS_POWER_BACKUP) {
+        enterBackup();
+    } else {
+        applyMode(state == GPS_POWER_TRACKING);
+    }
+    powerApplied = state;
+}
+
+// $GPRMC / $GNGGA ...: the type is the three characters after the talker ID
+static bool wantedSentence(const char *s, size_t len) {
+    if (len < 6) return false;
+    return (s[3] == 'R' && s[4] == 'M' && s[5] == 'C') ||
+           (s[3] == 'G' && s[4] == 'G' && s[5] == 'A');
+}
+
+static void finishLine() {
+    if (lineOverlong) {
+        stats.sentencesOverlong++;
+    } else if (wantedSentence(line, lineLen)) {
+        xSemaphoreTake(parserMutex, portMAX_DELAY);
+        for (size_t i = 0; i < lineLen; i++) {
+            gpsParser->encode(line[i]);
+        }
+        gpsParser->encode('\r');
+        gpsParser->encode('\n');
+        gpsFixCacheUpdate(*gpsParser);
+        xSemaphoreGive(parserMutex);
+        stats.sentencesPassed++;
+    } else if (lineLen > 0) {
+        stats.sentencesFiltered++;
+    }
+    lineLen = 0;
+    lineOverlong = false;
+}
+
+// Whole sentences are assembled here, so TinyGPS++ (and the mutex) only
+// ever sees the two types we use. UBX ACKs and other binary noise between
+// sentences are discarded because they never start with '$'.
+static void ingestByte(char c) {
+    if (c == '$') {
+        lineLen = 0;
+        lineOverlong = false;
+        line[lineLen++] = c;
+        return;
+    }
+    if (lineLen == 0) return;
+    if (c == '\r') return;
+    if (c == '\n') {
+        finishLine();
+        return;
+    }
+    if (lineLen < GPS_NMEA_MAX) {
+        line[lineLen++] = c;
+    } else {
+        lineOverlong = true;
+    }
+}
+
+static void handlePvt(const UbxNavPvt &pvt) {
+    stats.pvtFrames++;
+    xSemaphoreTake(parserMutex, portMAX_DELAY);
+
+    const uint8_t timeBits = UBX_PVT_VALID_DATE | UBX_PVT_VALID_TIME | UBX_PVT_FULLY_RESOLVED;
+    uint32_t utc = 0;
+    if ((pvt.valid & timeBits) == timeBits) {
+        utc = frameUtcSeconds(pvt.year, pvt.month, pvt.day, pvt.hour, pvt.min, pvt.sec);
+        gpsClockSet((int64_t)utc * 1000000 + pvt.nano / 1000);
+    }
+
+    uint32_t pdopX10 = pvt.pDOP / 10;
+    bool fixOk = (pvt.flags & UBX_PVT_GNSS_FIX_OK) && pvt.fixType >= UBX_FIX_2D &&
+                 pvt.fixType <= UBX_FIX_GNSS_DR;
+    if (fixOk && pvt.numSV >= GPS_FIX_MIN_SATS && pdopX10 <= GPS_FIX_MAX_HDOP_X10) {
+        GpsFix fix;
+        fix.lat_e7 = pvt.lat;
+        fix.lng_e7 = pvt.lon;
+        fix.utc = utc;
+        fix.hdop_x10 = (uint8_t)pdopX10;
+        fix.sats = pvt.numSV;
+        uint32_t accM = (pvt.hAcc + 999) / 1000;
+        fix.accM = accM == 0 ? 1 : (accM > 255 ? 255 : (uint8_t)accM);
+        fix.speedMps = pvt.gSpeed / 1000.0f;
+        fix.courseDeg = pvt.headMot / 1e5f;
+        // Emitted at the end of the epoch; transport delay is a few ms
+        gpsFixCacheStore(fix, 0);
+    }
+    xSemaphoreGive(parserMutex);
+}
+
+static void finishUbx() {
+    if (ubxRxCk[0] != ubxCkA || ubxRxCk[1] != ubxCkB || ubxLen > UBX_MAX_PAYLOAD) {
+        stats.ubxErrors++;
+        return;
+    }
+    if (ubxHeader[0] == UBX_CLASS_NAV && ubxHeader[1] == UBX_NAV_PVT && ubxLen == sizeof(UbxNavPvt)) {
+        handlePvt(*reinterpret_cast<const UbxNavPvt *>(ubxPayload));
+    }
+    // ACK/NAK for our CFG messages and anything else is ignored
+}
+
+static inline void ubxChecksum(uint8_t b) {
+    ubxCkA += b;
+    ubxCkB += ubxCkA;
+}
+
+// Byte-at-a-time UBX framer; oversized payloads are skipped, not stored
+static void ingestUbxByte(uint8_t b) {
+    switch (ubxState) {
+        case UBX_SYNC_1:
+            if (b == UBX_SYNC1) ubxState = UBX_SYNC_2;
+            break;
+        case UBX_SYNC_2:
+            ubxState = (b == UBX_SYNC2) ? UBX_HEADER : (b == UBX_SYNC1 ? UBX_SYNC_2 : UBX_SYNC_1);
+            ubxPos = 0;
+            ubxCkA = ubxCkB = 0;
+            break;
+        case UBX_HEADER:
+            ubxHeader[ubxPos++] = b;
+            ubxChecksum(b);
+            if (ubxPos == sizeof(ubxHeader)) {
+                ubxLen = ubxHeader[2] | (ubxHeader[3] << 8);
+                ubxPos = 0;
+                ubxState = ubxLen > 0 ? UBX_PAYLOAD : UBX_CHECKSUM;
+            }
+            break;
+        case UBX_PAYLOAD:
+            if (ubxPos < UBX_MAX_PAYLOAD) ubxPayload[ubxPos] = b;
+            ubxPos++;
+            ubxChecksum(b);
+            if (ubxPos == ubxLen) {
+                ubxPos = 0;
+                ubxState = UBX_CHECKSUM;
+            }
+            break;
+        case UBX_CHECKSUM:
+            ubxRxCk[ubxPos++] = b;
+            if (ubxPos == 2) {
+                finishUbx();
+                ubxState = UBX_SYNC_1;
+            }
+            break;
+    }
+}
+
+// Runs on the UART driver's event task
+static void onGpsReceive() {
+    if (gpsTaskHandle != NULL) xTaskNotifyGive(gpsTaskHandle);
+}
+
+static void gpsTask(void *arg) {
+    uint8_t buf[128];
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(GPS_IDLE_WAKE_MS));
+        int avail;
+        while ((avail = gpsPort->available()) > 0) {
+            size_t n = gpsPort->readBytes(buf, avail < (int)sizeof(buf) ? avail : sizeof(buf));
+            stats.bytes += n;
+            for (size_t i = 0; i < n; i++) {
+                if (gpsProtocol == GPS_PROTOCOL_UBX_PVT) {
+                    ingestUbxByte(buf[i]);
+                } else {
+                    ingestByte((char)buf[i]);
+                }
+            }
+        }
+
+        GpsPowerState wanted = GPS_POWER_SAVE;
+        if ((int32_t)(boostUntil - millis()) > 0) {
+            wanted = GPS_POWER_TRACKING;
+        } else if (backupRequested) {
+            wanted = GPS_POWER_BACKUP;
+        }
+        if (wanted != powerApplied) {
+            applyPowerState(wanted);
+        }
+    }
+}
+
+bool gpsIngestBegin(HardwareSerial &port, int8_t rxPin, int8_t txPin, TinyGPSPlus &gps,
+                    SemaphoreHandle_t gpsMutex, GpsProtocol protocol) {
+    if (gpsTaskHandle != NULL) return true;
+
+    gpsPort = &port;
+    gpsParser = &gps;
+    parserMutex = gpsMutex;
+    gpsProtocol = protocol;
+
+    // The driver's ring buffer is sized at begin(), so this must come first
+    port.setRxBufferSize(GPS_RX_BUFFER_BYTES);
+    port.begin(GPS_BOOT_BAUD, SERIAL_8N1, rxPin, txPin);
+    delay(200);
+    changeBaudrate();
+    port.flush();
+    delay(50);
+    port.updateBaudRate(GPS_RUN_BAUD);
+    delay(50);
+
+    configureMessages();
+    applyMode(false);
+    powerApplied = GPS_POWER_SAVE;
+    port.flush();
+
+    port.setRxFIFOFull(GPS_RX_FIFO_FULL);
+    port.setRxTimeout(GPS_RX_TIMEOUT_SYMBOLS);
+    port.onReceive(onGpsReceive);
+
+    BaseType_t ok = xTaskCreatePinnedToCore(gpsTask, "gps", GPS_TASK_STACK, NULL, GPS_TASK_PRIORITY,
+                                            &gpsTaskHandle, GPS_TASK_CORE);
+    return ok == pdPASS;
+}
+
+void gpsBoost() {
+    boostUntil = millis() + GPS_BOOST_HOLD_MS;
+    if (gpsTaskHandle != NULL) xTaskNotifyGive(gpsTaskHandle);
+}
+
+void gpsSetBackup(bool backup) {
+    backupRequested = backup;
+    if (gpsTaskHandle != NULL) xTaskNotifyGive(gpsTaskHandle);
+}
+
+GpsPowerState gpsPowerState() {
+    return powerApplied;
+}
+
+GpsIngestStats gpsIngestStats() {
+    return stats;
+}
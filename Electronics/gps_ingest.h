@@ -0,0 +1,68 @@
+// GPS UART ingest: event-driven RX, NMEA sentence filter and u-blox setup
+#pragma once
+
+#include <Arduino.h>
+#include <TinyGPS++.h>
+#include "freertos/semphr.h"
+
+#define GPS_BOOT_BAUD        9600     // u-blox factory default
+#define GPS_RUN_BAUD         115200
+#define GPS_RX_BUFFER_BYTES  2048     // ~180 ms of input at 115200 before the driver drops bytes
+#define GPS_RX_FIFO_FULL     64       // Wake the task after this many bytes ...
+#define GPS_RX_TIMEOUT_SYMBOLS 10     // ... or this many idle symbols after a burst
+#define GPS_IDLE_WAKE_MS     200      // Safety net if a receive callback is missed
+
+#define GPS_TASK_CORE        0
+#define GPS_TASK_PRIORITY    3
+#define GPS_TASK_STACK       3072
+
+// Longest NMEA sentence is 82 characters including $ and CR LF
+#define GPS_NMEA_MAX         96
+
+// Navigation rate and receiver power mode. Normally 1 Hz in power save;
+// gpsBoost() switches to 5 Hz continuous tracking for the alert and the
+// GPS_BOOST_HOLD_MS after it so positions converge while it matters.
+#define GPS_RATE_IDLE_MS     1000
+#define GPS_RATE_BOOST_MS    200
+#define GPS_BOOST_HOLD_MS    30000
+
+// Receiver power states, driven by gpsBoost() / gpsSetBackup()
+enum GpsPowerState {
+    GPS_POWER_TRACKING,               // GPS_RATE_BOOST_MS, continuous
+    GPS_POWER_SAVE,                   // GPS_RATE_IDLE_MS, UBX power save mode
+    GPS_POWER_BACKUP                  // RXM-PMREQ backup until UART activity; no fixes
+};
+
+enum GpsProtocol {
+    GPS_PROTOCOL_NMEA,                // RMC + GGA through TinyGPS++
+    GPS_PROTOCOL_UBX_PVT              // One binary NAV-PVT per epoch, NMEA off
+};
+
+struct GpsIngestStats {
+    uint32_t bytes;
+    uint32_t sentencesPassed;         // RMC/GGA handed to TinyGPS++
+    uint32_t sentencesFiltered;       // Other NMEA types, skipped without parsing
+    uint32_t sentencesOverlong;       // Garbled lines longer than GPS_NMEA_MAX
+    uint32_t pvtFrames;               // NAV-PVT decoded
+    uint32_t ubxErrors;               // Bad checksum or oversized UBX messages
+};
+
+// Bring the port up at the boot baud, switch the module and port to
+// GPS_RUN_BAUD, select the output messages for the protocol (NMEA: RMC and
+// GGA only; UBX: NAV-PVT only), then start the ingest task. Fixes go to the
+// fix cache; gps (NMEA mode) is only touched while holding gpsMutex.
+bool gpsIngestBegin(HardwareSerial &port, int8_t rxPin, int8_t txPin, TinyGPSPlus &gps,
+                    SemaphoreHandle_t gpsMutex, GpsProtocol protocol);
+
+// Request fast, continuous tracking for the next GPS_BOOST_HOLD_MS. Safe
+// from any task; the GPS task sends the configuration.
+void gpsBoost();
+
+// Put the receiver in (or bring it out of) backup. It keeps ephemeris and
+// time in battery-backed RAM, so fixes resume with a hot start. gpsBoost()
+// overrides backup. Safe from any task.
+void gpsSetBackup(bool backup);
+
+GpsPowerState gpsPowerState();
+
+GpsIngestStats gpsIngestStats();
@@ -0,0 +1,52 @@
+#include "heap_stats.h"
+#include "esp_heap_caps.h"
+#include "fixed_format.h"
+
+#define HEAP_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+
+static multi_heap_info_t alertStart;
+static bool alertOpen = false;
+static HeapAlertDelta delta = {};
+
+HeapStats heapStatsSample() {
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, HEAP_CAPS);
+
+    HeapStats s;
+    s.freeBytes = info.total_free_bytes;
+    s.minFreeBytes = info.minimum_free_bytes;
+    s.largestBlock = info.largest_free_block;
+    s.fragmentationPct = info.total_free_bytes > 0
+        ? (uint8_t)(100 - (uint64_t)info.largest_free_block * 100 / info.total_free_bytes)
+        : 0;
+    s.allocatedBlocks = info.allocated_blocks;
+    return s;
+}
+
+void heapAlertBegin() {
+    heap_caps_get_info(&alertStart, HEAP_CAPS);
+    alertOpen = true;
+}
+
+void heapAlertEnd() {
+    if (!alertOpen) return;
+    alertOpen = false;
+
+    multi_heap_info_t now;
+    heap_caps_get_info(&now, HEAP_CAPS);
+    delta.lastBlocks = (int32_t)now.allocated_blocks - (int32_t)alertStart.allocated_blocks;
+    delta.lastBytes = (int32_t)now.total_allocated_bytes - (int32_t)alertStart.total_allocated_bytes;
+    if (delta.lastBlocks > delta.maxBlocks) delta.maxBlocks = delta.lastBlocks;
+    delta.alerts++;
+}
+
+HeapAlertDelta heapAlertDelta() {
+    return delta;
+}
+
+void heapStatsPrint(Print &out) {
+    HeapStats s = heapStatsSample();
+    fixedLog(out, "Heap: %lu free, %lu min, %lu largest (%u%% fragmented), %lu blocks; last alert %+ld blocks %+ld bytes\n",
+             (unsigned long)s.freeBytes, (unsigned long)s.minFreeBytes, (unsigned long)s.largestBlock,
+             s.fragmentationPct, (unsigned long)s.allocatedBlocks, (long)delta.lastBlocks, (long)delta.lastBytes);
+}
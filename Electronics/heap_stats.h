@@ -0,0 +1,32 @@
+// Internal heap watermarks, and the net heap use of each alert
+#pragma once
+
+#include <Arduino.h>
+
+struct HeapStats {
+    uint32_t freeBytes;
+    uint32_t minFreeBytes;            // Low-water mark since boot
+    uint32_t largestBlock;
+    uint8_t fragmentationPct;         // 100 - largest block as a share of free
+    uint32_t allocatedBlocks;
+};
+
+// Net change across the last alert, sampled on the controller before the
+// trigger is handled and after the frame is queued. IDF 4.4 has no malloc
+// hooks, so this is blocks/bytes held afterwards, not a count of transient
+// allocations; other tasks can add noise, which the running max shows.
+struct HeapAlertDelta {
+    int32_t lastBlocks;
+    int32_t lastBytes;
+    int32_t maxBlocks;
+    uint32_t alerts;
+};
+
+HeapStats heapStatsSample();
+
+// Controller task: bracket one alert
+void heapAlertBegin();
+void heapAlertEnd();
+HeapAlertDelta heapAlertDelta();
+
+void heapStatsPrint(Print &out);
@@ -0,0 +1,35 @@
+// Host stand-ins for the few Arduino / FreeRTOS pieces the shared modules
+// use. The replay harness is single-threaded, so critical sections are
+// no-ops.
+#pragma once
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define IRAM_ATTR
+
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(const uint8_t *data, size_t len) = 0;
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+};
+
+// Print to a stdio stream, standing in for Serial
+class HostPrint : public Print {
+public:
+    explicit HostPrint(FILE *stream) : stream_(stream) {}
+    size_t write(const uint8_t *data, size_t len) override { return fwrite(data, 1, len, stream_); }
+
+private:
+    FILE *stream_;
+};
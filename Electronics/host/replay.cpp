@@ -0,0 +1,337 @@
+// Replay labelled WAV clips through the firmware's detection pipeline
+// (voice_detector.h) as fast as the host allows, and report detection
+// rates and per-frame CPU cost for each detector.
+//
+//   replay [options] LIST
+//
+// LIST has one clip per line, '#' starts a comment:
+//   scream      clips/scream_01.wav  [onset seconds]
+//   background  clips/street_03.wav
+//
+// A scream clip is detected when an alert fires at or after its onset
+// (default 0); alerts before the onset, and every alert in a background
+// clip, count as false positives. Clips must be 16 kHz 16-bit PCM; only the
+// first channel is used.
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "audio_levels.h"
+#include "voice_detector.h"
+#include "wav_reader.h"
+
+// Controller-side voice cooldown, APP_CONFIG_DEFAULTS
+#define REPLAY_DEFAULT_COOLDOWN_MS 2000
+
+struct Clip {
+    std::string path;
+    bool scream;
+    float onsetS;
+    WavClip wav;
+};
+
+struct Sweep {
+    bool enabled = false;
+    int from = 0;
+    int to = 0;
+    int step = 1;
+};
+
+struct Options {
+    std::string list;
+    bool runPeak = true;
+    bool runClassifier = true;
+    uint32_t cooldownMs = REPLAY_DEFAULT_COOLDOWN_MS;
+    AudioLevelConfig levels = LEVEL_DEFAULT_CONFIG;
+    Sweep sweepScore;
+    Sweep sweepPeak;
+    bool verbose = false;
+};
+
+struct ClipResult {
+    uint32_t alerts;
+    uint32_t falseAlerts;
+    bool detected;
+    float firstAlertS;                // Latency measure for scream clips, -1 if none
+};
+
+struct RunResult {
+    uint32_t screams = 0;
+    uint32_t detected = 0;
+    uint32_t backgroundClips = 0;
+    uint32_t backgroundClipsAlerted = 0;
+    uint32_t falseAlerts = 0;
+    double backgroundSeconds = 0;
+    double audioSeconds = 0;
+    double latencySum = 0;
+    std::vector<double> frameNs;
+};
+
+static void usage() {
+    fprintf(stderr,
+            "usage: replay [options] LIST\n"
+            "  --detector peak|classifier|both   (both)\n"
+            "  --cooldown-ms N                   voice alert cooldown (%d)\n"
+            "  --trigger-margin-db N             floor margin (AudioLevelConfig)\n"
+            "  --min-peak N                      peak detector threshold\n"
+            "  --score-threshold N               classifier logit threshold\n"
+            "  --sweep-score FROM:TO:STEP        classifier threshold sweep\n"
+            "  --sweep-peak FROM:TO:STEP         peak threshold sweep\n"
+            "  -v                                per-clip results\n",
+            REPLAY_DEFAULT_COOLDOWN_MS);
+    exit(2);
+}
+
+static bool parseSweep(const char *arg, Sweep &sweep) {
+    if (sscanf(arg, "%d:%d:%d", &sweep.from, &sweep.to, &sweep.step) != 3 || sweep.step <= 0) return false;
+    sweep.enabled = true;
+    return true;
+}
+
+static Options parseArgs(int argc, char **argv) {
+    Options o;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        auto value = [&]() -> const char * {
+            if (i + 1 >= argc) usage();
+            return argv[++i];
+        };
+        if (a == "--detector") {
+            std::string d = value();
+            o.runPeak = d == "peak" || d == "both";
+            o.runClassifier = d == "classifier" || d == "both";
+            if (!o.runPeak && !o.runClassifier) usage();
+        } else if (a == "--cooldown-ms") {
+            o.cooldownMs = (uint32_t)atoi(value());
+        } else if (a == "--trigger-margin-db") {
+            o.levels.triggerMarginDb = (uint8_t)atoi(value());
+        } else if (a == "--min-peak") {
+            o.levels.minTriggerPeak = (int16_t)atoi(value());
+        } else if (a == "--score-threshold") {
+            o.levels.scoreThreshold = (int8_t)atoi(value());
+        } else if (a == "--sweep-score") {
+            if (!parseSweep(value(), o.sweepScore)) usage();
+        } else if (a == "--sweep-peak") {
+            if (!parseSweep(value(), o.sweepPeak)) usage();
+        } else if (a == "-v") {
+            o.verbose = true;
+        } else if (a[0] == '-' || !o.list.empty()) {
+            usage();
+        } else {
+            o.list = a;
+        }
+    }
+    if (o.list.empty()) usage();
+    return o;
+}
+
+static bool loadClips(const std::string &listPath, std::vector<Clip> &clips) {
+    std::ifstream list(listPath);
+    if (!list) {
+        fprintf(stderr, "%s: cannot open\n", listPath.c_str());
+        return false;
+    }
+
+    // Paths are relative to the list file
+    std::string base;
+    size_t slash = listPath.rfind('/');
+    if (slash != std::string::npos) base = listPath.substr(0, slash + 1);
+
+    std::string line;
+    int lineNo = 0;
+    bool ok = true;
+    while (std::getline(list, line)) {
+        lineNo++;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        std::istringstream fields(line);
+        std::string label, path;
+        if (!(fields >> label)) continue;
+
+        Clip clip;
+        clip.onsetS = 0;
+        if (!(fields >> path) || (label != "scream" && label != "background")) {
+            fprintf(stderr, "%s:%d: expected 'scream|background PATH [onset]'\n", listPath.c_str(), lineNo);
+            ok = false;
+            continue;
+        }
+        fields >> clip.onsetS;
+        clip.scream = label == "scream";
+        clip.path = path[0] == '/' ? path : base + path;
+
+        std::string error;
+        if (!wavRead(clip.path, clip.wav, error)) {
+            fprintf(stderr, "%s: %s\n", clip.path.c_str(), error.c_str());
+            ok = false;
+            continue;
+        }
+        if (clip.wav.sampleRate != AUDIO_SAMPLE_RATE) {
+            fprintf(stderr, "%s: %u Hz, need %u Hz (resample first, e.g. sox in.wav -r 16000 out.wav)\n",
+                    clip.path.c_str(), clip.wav.sampleRate, AUDIO_SAMPLE_RATE);
+            ok = false;
+            continue;
+        }
+        clips.push_back(std::move(clip));
+    }
+    return ok;
+}
+
+// One clip from a fresh noise floor, frame by frame as the capture and
+// detector tasks see it; the controller's cooldown is applied on top
+static ClipResult replayClip(const Clip &clip, VoiceDetector detector, uint32_t cooldownMs,
+                             std::vector<double> &frameNs) {
+    static AudioFrame frame;
+    VoiceSustain sustain;
+    voiceSustainReset(sustain);
+    audioLevelsReset();
+
+    ClipResult r = {0, 0, false, -1.0f};
+    bool alerted = false;
+    uint32_t lastAlertMs = 0;
+    uint32_t onsetMs = (uint32_t)(clip.onsetS * 1000.0f);
+    size_t total = clip.wav.samples.size();
+
+    for (size_t pos = 0; pos + AUDIO_FRAME_SAMPLES <= total; pos += AUDIO_FRAME_SAMPLES) {
+        memcpy(frame.samples, &clip.wav.samples[pos], AUDIO_FRAME_BYTES);
+        frame.sample_count = AUDIO_FRAME_SAMPLES;
+        frame.timestamp_us = (int64_t)(pos + AUDIO_FRAME_SAMPLES) * 1000000 / AUDIO_SAMPLE_RATE;
+        uint32_t frameMs = (uint32_t)(frame.timestamp_us / 1000);
+
+        auto start = std::chrono::steady_clock::now();
+        voiceAnalyzeFrame(&frame, detector, nullptr);
+        VoiceStep step = voiceSustainStep(sustain, &frame, detector);
+        auto end = std::chrono::steady_clock::now();
+        frameNs.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+
+        if (step != VOICE_STEP_ALERT) continue;
+        if (alerted && frameMs - lastAlertMs <= cooldownMs) continue;
+        alerted = true;
+        lastAlertMs = frameMs;
+        r.alerts++;
+
+        if (clip.scream && frameMs >= onsetMs) {
+            if (!r.detected) r.firstAlertS = (frameMs - onsetMs) / 1000.0f;
+            r.detected = true;
+        } else {
+            r.falseAlerts++;
+        }
+    }
+    return r;
+}
+
+static RunResult runCorpus(const std::vector<Clip> &clips, VoiceDetector detector, const Options &o,
+                           const AudioLevelConfig &levels) {
+    audioLevelSetConfig(levels);
+    RunResult run;
+    for (const Clip &clip : clips) {
+        ClipResult r = replayClip(clip, detector, o.cooldownMs, run.frameNs);
+        double seconds = (double)clip.wav.samples.size() / AUDIO_SAMPLE_RATE;
+        run.audioSeconds += seconds;
+        run.falseAlerts += r.falseAlerts;
+        if (clip.scream) {
+            run.screams++;
+            if (r.detected) {
+                run.detected++;
+                run.latencySum += r.firstAlertS;
+            }
+        } else {
+            run.backgroundClips++;
+            run.backgroundSeconds += seconds;
+            if (r.alerts > 0) run.backgroundClipsAlerted++;
+        }
+        if (o.verbose) {
+            printf("  %-10s %-40s %u alert(s)%s", clip.scream ? "scream" : "background", clip.path.c_str(),
+                   r.alerts, r.falseAlerts ? " FALSE" : "");
+            if (r.detected) printf(", first %.2f s after onset", r.firstAlertS);
+            if (clip.scream && !r.detected) printf(" MISSED");
+            printf("\n");
+        }
+    }
+    return run;
+}
+
+static double percentileNs(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t i = (size_t)(p / 100.0 * (values.size() - 1) + 0.5);
+    return values[i];
+}
+
+static void printRates(const RunResult &run) {
+    double fnRate = run.screams ? 100.0 * (run.screams - run.detected) / run.screams : 0;
+    double fpClipRate = run.backgroundClips ? 100.0 * run.backgroundClipsAlerted / run.backgroundClips : 0;
+    double fpPerHour = run.backgroundSeconds > 0 ? run.falseAlerts * 3600.0 / run.backgroundSeconds : 0;
+    printf("  screams detected   %u / %u (false negatives %.1f%%)", run.detected, run.screams, fnRate);
+    if (run.detected) printf(", mean latency %.2f s", run.latencySum / run.detected);
+    printf("\n");
+    printf("  false alerts       %u (%.1f%% of background clips, %.1f per hour of background)\n",
+           run.falseAlerts, fpClipRate, fpPerHour);
+}
+
+static void printCost(const RunResult &run) {
+    double sum = 0;
+    for (double ns : run.frameNs) sum += ns;
+    double mean = run.frameNs.empty() ? 0 : sum / run.frameNs.size();
+    double realtime = sum > 0 ? run.audioSeconds * 1e9 / sum : 0;
+    printf("  per frame          mean %.1f us, p99 %.1f us, max %.1f us (%zu frames, %.0fx real time)\n",
+           mean / 1000.0, percentileNs(run.frameNs, 99) / 1000.0, percentileNs(run.frameNs, 100) / 1000.0,
+           run.frameNs.size(), realtime);
+}
+
+static void runDetector(const std::vector<Clip> &clips, VoiceDetector detector, const Options &o) {
+    const char *name = detector == DETECTOR_PEAK ? "peak" : "classifier";
+    const Sweep &sweep = detector == DETECTOR_PEAK ? o.sweepPeak : o.sweepScore;
+
+    if (!sweep.enabled) {
+        int threshold = detector == DETECTOR_PEAK ? o.levels.minTriggerPeak : o.levels.scoreThreshold;
+        printf("%s detector (threshold %d, margin %u dB)\n", name, threshold, o.levels.triggerMarginDb);
+        RunResult run = runCorpus(clips, detector, o, o.levels);
+        printRates(run);
+        printCost(run);
+        printf("\n");
+        return;
+    }
+
+    printf("%s detector threshold sweep (margin %u dB)\n", name, o.levels.triggerMarginDb);
+    printf("  %9s %9s %9s %9s %11s\n", "threshold", "detected", "FN %", "false", "false/hour");
+    for (int t = sweep.from; t <= sweep.to; t += sweep.step) {
+        AudioLevelConfig levels = o.levels;
+        if (detector == DETECTOR_PEAK) {
+            levels.minTriggerPeak = (int16_t)t;
+        } else {
+            levels.scoreThreshold = (int8_t)t;
+        }
+        Options quiet = o;
+        quiet.verbose = false;
+        RunResult run = runCorpus(clips, detector, quiet, levels);
+        printf("  %9d %4u/%-4u %9.1f %9u %11.1f\n", t, run.detected, run.screams,
+               run.screams ? 100.0 * (run.screams - run.detected) / run.screams : 0.0, run.falseAlerts,
+               run.backgroundSeconds > 0 ? run.falseAlerts * 3600.0 / run.backgroundSeconds : 0.0);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    Options o = parseArgs(argc, argv);
+
+    std::vector<Clip> clips;
+    if (!loadClips(o.list, clips)) return 1;
+    if (clips.empty()) {
+        fprintf(stderr, "%s: no clips\n", o.list.c_str());
+        return 1;
+    }
+
+    double seconds = 0;
+    for (const Clip &clip : clips) seconds += (double)clip.wav.samples.size() / AUDIO_SAMPLE_RATE;
+    printf("%zu clips, %.1f s of audio, cooldown %u ms\n\n", clips.size(), seconds, o.cooldownMs);
+
+    if (o.runPeak) runDetector(clips, DETECTOR_PEAK, o);
+    if (o.runClassifier) runDetector(clips, DETECTOR_CLASSIFIER, o);
+    return 0;
+}
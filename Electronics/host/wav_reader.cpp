@@ -0,0 +1,64 @@
+#include "wav_reader.h"
+#include <stdio.h>
+#include <string.h>
+
+static uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool wavRead(const std::string &path, WavClip &clip, std::string &error) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == nullptr) {
+        error = "cannot open";
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+
+    if (data.size() < 12 || memcmp(&data[0], "RIFF", 4) != 0 || memcmp(&data[8], "WAVE", 4) != 0) {
+        error = "not a RIFF/WAVE file";
+        return false;
+    }
+
+    uint16_t format = 0, channels = 0, bits = 0;
+    bool haveFormat = false;
+    size_t pos = 12;
+    while (pos + 8 <= data.size()) {
+        uint32_t size = get32(&data[pos + 4]);
+        size_t body = pos + 8;
+        size_t end = body + size > data.size() ? data.size() : body + size;
+        if (memcmp(&data[pos], "fmt ", 4) == 0 && size >= 16) {
+            format = get16(&data[body]);
+            channels = get16(&data[body + 2]);
+            clip.sampleRate = get32(&data[body + 4]);
+            bits = get16(&data[body + 14]);
+            haveFormat = true;
+        } else if (memcmp(&data[pos], "data", 4) == 0) {
+            if (!haveFormat) {
+                error = "data before fmt chunk";
+                return false;
+            }
+            if (format != 1 || bits != 16 || channels == 0) {
+                error = "not 16-bit PCM";
+                return false;
+            }
+            size_t frameBytes = 2 * channels;
+            clip.samples.clear();
+            clip.samples.reserve((end - body) / frameBytes);
+            for (size_t p = body; p + frameBytes <= end; p += frameBytes) {
+                clip.samples.push_back((int16_t)get16(&data[p]));
+            }
+            return true;
+        }
+        pos = body + size + (size & 1);   // Chunks are word-aligned
+    }
+    error = "no data chunk";
+    return false;
+}
@@ -0,0 +1,14 @@
+// Minimal RIFF/WAVE reader for the replay harness: 16-bit PCM only
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct WavClip {
+    uint32_t sampleRate;
+    std::vector<int16_t> samples;     // First channel only
+};
+
+// False with a reason in error when the file can't be used as-is
+bool wavRead(const std::string &path, WavClip &clip, std::string &error);
@@ -0,0 +1,124 @@
+#include "imu_detector.h"
+#include <Wire.h>
+#include "esp_timer.h"
+#include "trigger_fusion.h"
+
+#define LSM6DS3_WHO_AM_I     0x0F
+#define LSM6DS3_CTRL1_XL     0x10
+#define LSM6DS3_CTRL3_C      0x12
+#define LSM6DS3_OUTX_L_XL    0x28
+#define LSM6DS3_ID           0x69
+#define LSM6DS3TRC_ID        0x6A
+
+#define LSM6DS3_XL_52HZ_8G   0x3C     // ODR 52 Hz, +-8 g
+#define LSM6DS3_BDU_INC      0x44     // Block data update, address auto-increment
+#define LSM6DS3_MG_PER_LSB_X1000 244  // 0.244 mg/LSB at +-8 g
+
+// Task-owned detection state
+static int64_t freefallStartUs = 0;   // Under the free-fall threshold since, 0 = not
+static int64_t freefallSeenUs = 0;    // Last qualifying free fall, 0 = none
+static bool aboveShake = false;
+static int64_t shakeTimes[IMU_SHAKE_COUNT];
+static uint8_t shakeHead = 0;
+static uint8_t shakeCount = 0;
+
+static bool writeReg(uint8_t reg, uint8_t value) {
+    Wire.beginTransmission(IMU_I2C_ADDR);
+    Wire.write(reg);
+    Wire.write(value);
+    return Wire.endTransmission() == 0;
+}
+
+static bool readRegs(uint8_t reg, uint8_t *out, size_t len) {
+    Wire.beginTransmission(IMU_I2C_ADDR);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0) return false;
+    if (Wire.requestFrom((uint8_t)IMU_I2C_ADDR, (uint8_t)len) != len) return false;
+    for (size_t i = 0; i < len; i++) out[i] = Wire.read();
+    return true;
+}
+
+static bool readMagnitudeMg(uint32_t &mg) {
+    uint8_t raw[6];
+    if (!readRegs(LSM6DS3_OUTX_L_XL, raw, sizeof(raw))) return false;
+    float sum = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        float a = (int16_t)(raw[2 * axis] | raw[2 * axis + 1] << 8) * (LSM6DS3_MG_PER_LSB_X1000 / 1000.0f);
+        sum += a * a;
+    }
+    mg = (uint32_t)sqrtf(sum);
+    return true;
+}
+
+static void detectFall(uint32_t mg, int64_t now) {
+    if (mg < IMU_FREEFALL_MG) {
+        if (freefallStartUs == 0) freefallStartUs = now;
+        if (now - freefallStartUs >= IMU_FREEFALL_MS * 1000LL) freefallSeenUs = now;
+        return;
+    }
+    freefallStartUs = 0;
+
+    if (mg > IMU_IMPACT_MG) {
+        bool fell = freefallSeenUs != 0 && now - freefallSeenUs <= IMU_IMPACT_WINDOW_MS * 1000LL;
+        triggerPost(TRIGGER_SRC_IMU_FALL, fell ? TRIGGER_SCORE_CERTAIN : IMU_WEAK_SCORE, now);
+        freefallSeenUs = 0;
+    }
+}
+
+static void detectShake(uint32_t mg, int64_t now) {
+    bool above = mg > IMU_SHAKE_MG;
+    bool rising = above && !aboveShake;
+    aboveShake = above;
+    if (!rising) return;
+
+    shakeTimes[shakeHead] = now;
+    shakeHead = (shakeHead + 1) % IMU_SHAKE_COUNT;
+    if (shakeCount < IMU_SHAKE_COUNT) shakeCount++;
+
+    // Excursions still inside the window, newest first
+    int64_t windowStart = now - IMU_SHAKE_WINDOW_MS * 1000LL;
+    uint8_t recent = 0;
+    for (uint8_t i = 0; i < shakeCount; i++) {
+        uint8_t at = (shakeHead + IMU_SHAKE_COUNT - 1 - i) % IMU_SHAKE_COUNT;
+        if (shakeTimes[at] < windowStart) break;
+        recent++;
+    }
+    if (recent >= IMU_SHAKE_COUNT) {
+        triggerPost(TRIGGER_SRC_IMU_SHAKE, TRIGGER_SCORE_CERTAIN, now);
+        shakeCount = 0;
+    } else if (recent >= IMU_SHAKE_WEAK) {
+        triggerPost(TRIGGER_SRC_IMU_SHAKE, IMU_WEAK_SCORE, now);
+    }
+}
+
+static void imuTask(void *arg) {
+    TickType_t wake = xTaskGetTickCount();
+    for (;;) {
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(IMU_SAMPLE_MS));
+        uint32_t mg;
+        if (!readMagnitudeMg(mg)) continue;
+        int64_t now = esp_timer_get_time();
+        detectFall(mg, now);
+        detectShake(mg, now);
+    }
+}
+
+bool imuDetectorBegin() {
+    if (!Wire.begin(IMU_I2C_SDA, IMU_I2C_SCL, IMU_I2C_FREQ_HZ)) return false;
+
+    uint8_t id = 0;
+    if (!readRegs(LSM6DS3_WHO_AM_I, &id, 1) || (id != LSM6DS3_ID && id != LSM6DS3TRC_ID)) {
+        Wire.end();
+        return false;
+    }
+    if (!writeReg(LSM6DS3_CTRL3_C, LSM6DS3_BDU_INC) || !writeReg(LSM6DS3_CTRL1_XL, LSM6DS3_XL_52HZ_8G)) {
+        return false;
+    }
+
+    triggerRegister(TRIGGER_SRC_IMU_FALL, {"imu fall", ALERT_FRAME_MOTION, TRIGGER_SCORE_CERTAIN, IMU_COOLDOWN_MS, true});
+    triggerRegister(TRIGGER_SRC_IMU_SHAKE, {"imu shake", ALERT_FRAME_MOTION, TRIGGER_SCORE_CERTAIN, IMU_COOLDOWN_MS, true});
+
+    BaseType_t ok = xTaskCreatePinnedToCore(imuTask, "imu", IMU_TASK_STACK, NULL, IMU_TASK_PRIORITY, NULL,
+                                            IMU_TASK_CORE);
+    return ok == pdPASS;
+}
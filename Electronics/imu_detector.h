@@ -0,0 +1,39 @@
+// Fall and shake detection from an optional I2C accelerometer
+#pragma once
+
+#include <Arduino.h>
+
+// LSM6DS3 / LSM6DS3TR-C on the XIAO D4/D5 pads. The Sense board has no
+// IMU of its own; imuDetectorBegin() probes WHO_AM_I and leaves the
+// sources unregistered when nothing answers.
+#define IMU_I2C_SDA          5
+#define IMU_I2C_SCL          6
+#define IMU_I2C_ADDR         0x6A
+#define IMU_I2C_FREQ_HZ      400000
+
+#define IMU_TASK_CORE        0
+#define IMU_TASK_PRIORITY    2        // Below everything on the alert path
+#define IMU_TASK_STACK       2048
+#define IMU_SAMPLE_MS        20       // 52 Hz output data rate, polled
+
+// Fall: free fall (|a| under IMU_FREEFALL_MG for IMU_FREEFALL_MS), then an
+// impact over IMU_IMPACT_MG within IMU_IMPACT_WINDOW_MS. An impact without
+// the free fall is only a weak event for the fusion stage.
+#define IMU_FREEFALL_MG      400
+#define IMU_FREEFALL_MS      100
+#define IMU_IMPACT_MG        2500
+#define IMU_IMPACT_WINDOW_MS 1000
+
+// Shake: excursions over IMU_SHAKE_MG within IMU_SHAKE_WINDOW_MS;
+// IMU_SHAKE_WEAK of them are a weak event, IMU_SHAKE_COUNT an alert
+#define IMU_SHAKE_MG         1800
+#define IMU_SHAKE_WINDOW_MS  1500
+#define IMU_SHAKE_WEAK       3
+#define IMU_SHAKE_COUNT      6
+
+#define IMU_WEAK_SCORE       128
+#define IMU_COOLDOWN_MS      10000
+
+// Probe the sensor, register TRIGGER_SRC_IMU_FALL and TRIGGER_SRC_IMU_SHAKE
+// and start the polling task. False (and no task) without a sensor.
+bool imuDetectorBegin();
@@ -7,15 +7,42 @@
 #include <BLE2902.h>
 #include <I2S.h>
 #include "FS.h"
-#include "SD.h"
-#include "SPI.h"
+#include "audio_capture.h"
+#include "dsp_kernels.h"
+#include "wav_recorder.h"
+#include "ble_tx_queue.h"
+#include "alert_frame.h"
+#include "ble_link.h"
+#include "ble_xfer.h"
+#include "voice_classifier.h"
+#include "voice_detector.h"
+#include "app_tasks.h"
+#include "esp_timer.h"
+#include "gps_ingest.h"
+#include "gps_fix_cache.h"
+#include "power_manager.h"
+#include "audio_levels.h"
+#include "app_config.h"
+#include "command_protocol.h"
+#include "alert_log.h"
+#include "alert_beacon.h"
+#include "status_report.h"
+#include "fixed_format.h"
+#include "heap_stats.h"
+#include "trace.h"
+#include "sd_storage.h"
+#include "recording_catalog.h"
+#include "state_machine.h"
+#include "trigger_fusion.h"
+#include "imu_detector.h"
+#include "boot_sequence.h"
 
 // GPS Configuration
 TinyGPSPlus gps;
-#define GPSBaud 9600
 #define GPS_RX_PIN 44
 #define GPS_TX_PIN 43
 #define GPS_SERIAL_PORT Serial1
+#define GPS_PROTOCOL GPS_PROTOCOL_NMEA      // GPS_PROTOCOL_UBX_PVT on u-blox M8 and later
 
 // BLE Configuration
 #define SERVICE_UUID           "6e400001-b5a3-f393-e0a9-e50e24dcca9e"
@@ -23,357 +50,415 @@ TinyGPSPlus gps;
 #define CHARACTERISTIC_UUID_TX "6e400003-b5a3-f393-e0a9-e50e24dcca9e"
 BLECharacteristic *pTxCharacteristic = nullptr;
 BLECharacteristic *pRxCharacteristic = nullptr;
+BLECharacteristic *pXferCharacteristic = nullptr;
 BLEServer *pServer = nullptr;
-bool deviceConnected = false;
+
+// Inter-task plumbing, see app_tasks.h
+QueueHandle_t appEventQueue = NULL;
+EventGroupHandle_t appEventGroup = NULL;
+SemaphoreHandle_t gpsMutex = NULL;          // Guards gps between the GPS and controller tasks
 
 // Pin Trigger Configuration
 #define TRIGGER_PIN 1
-bool pinTriggered = false;
-unsigned long triggerBounceTime = 0;
-unsigned long debounceDelay = 100;
-
-// Voice Trigger Configuration
-#define RECORD_TIME   10
-#define SAMPLE_RATE   16000U
+#define PIN_DEBOUNCE_MS 100          // Button cooldown: closer edges are bounce
+
+// Pin edge to alert notify, measured on the controller task
+struct PinLatency {
+    uint32_t lastUs;
+    uint32_t maxUs;
+    uint32_t samples;
+    uint32_t overBudget;              // Samples above PIN_LATENCY_TARGET_US
+};
+PinLatency pinLatency = {};
+int64_t pinLatencyStartUs = 0;        // Edge time of the alert being measured, 0 = none
+
+// Voice Trigger Configuration (clip length, cooldown and levels are in AppConfig)
+#define PREROLL_TIME_MS 2000          // Audio kept from before the trigger
+#define HISTORY_MARGIN_MS 1000        // Extra history so SD stalls don't lose samples
+#define RECORDING_CODEC RECORDER_CODEC_IMA_ADPCM  // 4:1, 80KB per 10s clip
+#define SAMPLE_RATE   AUDIO_SAMPLE_RATE
 #define SAMPLE_BITS   16
-#define WAV_HEADER_SIZE 44
-#define SD_CS 21
-
-// Voice Monitoring settings
-#define MONITOR_BUFFER_SIZE (SAMPLE_RATE * SAMPLE_BITS / 8 * 0.05)  // 50ms buffer
-#define TRIGGER_THRESHOLD 2300
-#define RECORDING_GAIN 10
-#define RECORDING_NOISE_THRESHOLD 120
-
-// Scream detection settings
-#define SUSTAINED_TRIGGER_TIME 150    // 150ms sustained sound
-#define TRIGGER_SAMPLES_NEEDED 4      // 4 consecutive samples (200ms)
+
+// Voice Monitoring settings (one detector window = one AUDIO_FRAME_MS capture frame).
+// Trigger thresholds, recording gate and AGC are runtime levels relative to
+// the ambient floor, see audio_levels.h; the app changes them with
+// CMD_SET_CONFIG (command_protocol.h, keys in app_config.h).
+
+// Scream detection settings (sustain window in voice_detector.h)
 #define DEBUG_RECORDING_TIME 2
+#define VOICE_ONSET_SCORE 128         // Weak trigger for fusion: loud, not yet sustained
+
+// Mirrors AppConfig::detector for the capture task, see onConfigChanged()
+volatile VoiceDetector voiceDetector = DETECTOR_PEAK;
 
-// State management
-enum SystemState {
-  IDLE,
+// Controller states, see controllerTable. Recording is not a state: the
+// recorder runs alongside whichever state the controller is in.
+enum SystemState : uint8_t {
   MONITORING,
-  ALERT_TRIGGERED,
-  SENDING_ALERT, 
-  RECORDING
+  ALERT_HOLD                          // Just alerted
 };
 
-SystemState currentState = IDLE;
-uint8_t *monitor_buffer = NULL;
+// Owned by the controller task
+#define ALERT_HOLD_MS 100             // Pause after an alert before monitoring resumes
+esp_timer_handle_t holdTimer = nullptr;
+int64_t holdUntilUs = 0;
 int recordingCounter = 0;
-unsigned long lastAlertTime = 0;
-const unsigned long COOLDOWN_TIME = 2000; // 2 seconds between alerts
+char recordingPath[XFER_PATH_MAX] = "";
+uint32_t recordingId = 0;             // Catalog id of the clip being recorded
 unsigned long lastTriggerTime = 0;
-// Voice trigger variables
-volatile bool voiceTriggerDetected = false;
-hw_timer_t * timer = NULL;
-portMUX_TYPE timerMux = portMUX_INITIALIZER_UNLOCKED;
-int consecutiveTriggersCount = 0;
-unsigned long firstTriggerTime = 0;
-bool sustainedTriggerActive = false;
-
-// Alert tracking
-enum AlertType {
-  VOICE_ALERT,
-  PIN_ALERT
-};
-AlertType lastAlertType;
+TriggerDecision lastDecision;         // Set by the fusion guard for the alert action
+volatile bool buttonPending = false;  // Set by the pin ISR, cleared when the controller takes the edge
+// Voice trigger run (detector task only)
+VoiceSustain voiceSustain = {};
 
-void sendPacket(byte *packet, byte len);
-void changeBaudrate();
 void startTriggeredRecording();
 void pinTriggerActivated();
-void onTimer();
-void voiceTriggerInterrupt();
+void processVoiceFrame(const AudioFrame *frame);
+void analyzeVoiceFrame(AudioFrame *frame);
 void startRecording();
-void record_wav(int gain, int noise_threshold, const char *filename);
-void generate_wav_header(uint8_t *wav_header, uint32_t wav_size, uint32_t sample_rate);
-
-
-// GPS Functions
-void sendPacket(byte *packet, byte len) {
-    for (byte i = 0; i < len; i++) {
-        Serial1.write(packet[i]);
-    }
-}
-
-void changeBaudrate() {
-    byte packet[] = {
-        0xB5, 0x62, 0x06, 0x00, 0x14, 0x00, 0x01, 0x00, 0x00, 0x00, 0xD0, 0x08, 0x00, 0x00,
-        0x00, 0xC2, 0x01, 0x00, 0x07, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x7E
-    };
-    sendPacket(packet, sizeof(packet));
-}
-
-String gps_data() {
-    String data = "EMERGENCY ALERT!!\n";
+void postAppEvent(AppEventType type);
+void holdTimerExpired(void *arg);
+void recorderDone();
+void dispatchPendingEvents();
+void detectorTask(void *arg);
+void controllerTask(void *arg);
+bool record_wav(int gain, int noise_threshold, char *path, size_t pathSize);
+
+
+// Fill the binary alert frame from the fix cache, so an alert indoors still
+// carries the last good position and its age; no heap use
+size_t gps_alert_frame(AlertFrameType alertType, uint8_t flags, uint8_t *out) {
+    AlertFrame frame;
+    frame.alert_type = alertType;
+    frame.seq = alertLogTakeSeq();
+    frame.flags = flags;
     
-    if (gps.location.isValid()) {
-        data += "Location: " + String(gps.location.lat(), 6) + ", " + String(gps.location.lng(), 6) + "\n";
-        Serial.print("Location: ");
-        Serial.print(gps.location.lat(), 6);
-        Serial.print(", ");
-        Serial.println(gps.location.lng(), 6);
-    } else {
-        data += "Location: Not Available\n";
-        Serial.println("Location: Not Available");
-    }
+    // Hold the GPS task off only while copying; printing happens after
+    GpsPosition position;
+    xSemaphoreTake(gpsMutex, portMAX_DELAY);
+    bool havePosition = gpsFixCacheEstimate(position);
+    xSemaphoreGive(gpsMutex);
     
-    if (gps.date.isValid()) {
-        data += "Date: " + String(gps.date.month()) + "/" + String(gps.date.day()) + "/" + String(gps.date.year()) + "\n";
-    } else {
-        data += "Date: Not Available\n";
-    }
+    // The system clock follows GPS UTC whichever protocol is in use
+    frame.utc = gpsClockUtcNow();
+    if (frame.utc != 0 && !gpsClockFresh()) frame.flags |= FRAME_FLAG_CLOCK_TIME;
     
-    if (gps.time.isValid()) {
-        data += "Time: " + String(gps.time.hour()) + ":" + String(gps.time.minute()) + ":" + String(gps.time.second()) + "\n";
+    if (havePosition) {
+        uint32_t ageS = position.ageMs / 1000;
+        frame.lat_e7 = position.fix.lat_e7;
+        frame.lng_e7 = position.fix.lng_e7;
+        frame.hdop_x10 = position.fix.hdop_x10 >= FRAME_HDOP_UNKNOWN ? FRAME_HDOP_UNKNOWN - 1 : position.fix.hdop_x10;
+        frame.sats = position.fix.sats;
+        frame.fix_age_s = ageS >= FRAME_FIX_AGE_UNKNOWN ? FRAME_FIX_AGE_UNKNOWN - 1 : (uint16_t)ageS;
+        frame.acc_m = position.fix.accM;
+        if (!position.fresh) frame.flags |= FRAME_FLAG_FIX_CACHED;
+        if (position.deadReckoned) frame.flags |= FRAME_FLAG_DEAD_RECKONED;
+        fixedLog(Serial, "Location: %.6f, %.6f (%s, %lus old)\n", frame.lat_e7 / 1e7, frame.lng_e7 / 1e7,
+                         position.fresh ? "current" : (position.deadReckoned ? "dead-reckoned" : "last known"),
+                         (unsigned long)ageS);
     } else {
-        data += "Time: Not Available\n";
+        frame.lat_e7 = FRAME_LAT_UNKNOWN;
+        frame.lng_e7 = FRAME_LAT_UNKNOWN;
+        frame.hdop_x10 = FRAME_HDOP_UNKNOWN;
+        frame.sats = 0;
+        frame.fix_age_s = FRAME_FIX_AGE_UNKNOWN;
+        frame.acc_m = FRAME_ACC_UNKNOWN;
+        Serial.println("Location: Not Available");
     }
     
-    return data;
+    return alertFrameEncode(frame, out);
 }
 
-// Pin Trigger Interrupt
+// Pin Trigger Interrupt: timestamp and hand off, nothing else. Debounce (the
+// button's cooldown) and logging happen on the controller task; the edge
+// jumps the queue, and a full queue drops it. Contact bounce would otherwise
+// fill the queue, so edges are ignored while one is still waiting there.
 void IRAM_ATTR pinTriggerActivated() {
-    if (millis() - triggerBounceTime > debounceDelay) {
-        triggerBounceTime = millis();
-        pinTriggered = true;
-        lastAlertType = PIN_ALERT;
-        Serial.println("PIN TRIGGER ACTIVATED!");
+    TRACE(TRACE_PIN_ISR, 0);
+    if (buttonPending) return;
+    BaseType_t woken = pdFALSE;
+    if (triggerPostFromISR(TRIGGER_SRC_BUTTON, TRIGGER_SCORE_CERTAIN, esp_timer_get_time(), &woken)) {
+        buttonPending = true;
     }
+    portYIELD_FROM_ISR(woken);
 }
 
-// Voice Trigger Timer Interrupt
-void IRAM_ATTR onTimer() {
-    if (currentState == MONITORING) {
-        portENTER_CRITICAL_ISR(&timerMux);
-        voiceTriggerDetected = true;
-        portEXIT_CRITICAL_ISR(&timerMux);
-    }
+TriggerSource voiceSource() {
+    return voiceDetector == DETECTOR_CLASSIFIER ? TRIGGER_SRC_AUDIO_CLASSIFIER : TRIGGER_SRC_AUDIO_PEAK;
+}
+
+bool isConnected() {
+    return (xEventGroupGetBits(appEventGroup) & APP_BIT_CONNECTED) != 0;
 }
 
 // Voice processing functions
-int16_t findPeakLevel(uint8_t *buffer, size_t size) {
-    int16_t peak = 0;
-    for (size_t i = 0; i < size; i += 2) {
-        int16_t sample = *(int16_t *)(buffer + i);
-        int16_t absSample = abs(sample);
-        if (absSample > peak) {
-            peak = absSample;
+// Detector task: consume every frame the capture task commits
+void detectorTask(void *arg) {
+    for (;;) {
+        const AudioFrame *frame = audioCaptureWaitFrame(portMAX_DELAY);
+        if (frame == nullptr) continue;
+        
+        // Frames captured outside MONITORING are not acted on
+        if (xEventGroupGetBits(appEventGroup) & APP_BIT_MONITORING) {
+            processVoiceFrame(frame);
+        } else {
+            voiceSustainReset(voiceSustain);
         }
+        audioCaptureRelease();
     }
-    return peak;
 }
 
-void voiceTriggerInterrupt() {
-    if (currentState != MONITORING) return;
-    
-    size_t bytesRead = 0;
-    esp_i2s::i2s_read(esp_i2s::I2S_NUM_0, monitor_buffer, MONITOR_BUFFER_SIZE, &bytesRead, 50);
-    
-    if (bytesRead > 0) {
-        int16_t peak = findPeakLevel(monitor_buffer, bytesRead);
-        
-        if (peak > TRIGGER_THRESHOLD) {
-            if (!sustainedTriggerActive) {
-                sustainedTriggerActive = true;
-                firstTriggerTime = millis();
-                consecutiveTriggersCount = 1;
-                Serial.printf("Voice trigger detected. Peak: %d\n", peak);
-            } else {
-                consecutiveTriggersCount++;
-            }
-            
-            if (consecutiveTriggersCount >= TRIGGER_SAMPLES_NEEDED) {
-                unsigned long sustainedTime = millis() - firstTriggerTime;
+// Runs on the capture task for every frame, so the classifier keeps up with
+// real time regardless of what loop() is doing. In low power, frames below
+// the sound floor stop at the peak and never reach the classifier.
+void analyzeVoiceFrame(AudioFrame *frame) {
+    voiceAnalyzeFrame(frame, voiceDetector, powerFrameWanted);
+}
+
+void processVoiceFrame(const AudioFrame *frame) {
+    switch (voiceSustainStep(voiceSustain, frame, voiceDetector)) {
+        case VOICE_STEP_ONSET:
+            fixedLog(Serial, "Voice trigger detected. Peak: %d, score: %d\n", frame->peak, frame->score);
+            triggerPost(voiceSource(), VOICE_ONSET_SCORE, frame->timestamp_us);
+            break;
+        case VOICE_STEP_ALERT:
+            {
+                TRACE(TRACE_DETECTION, frame->score);
+                fixedLog(Serial, "VOICE ALERT! Sustained for %lu ms, Peak: %d, score: %d\n",
+                         (unsigned long)voiceSustain.sustainedMs, frame->peak, frame->score);
                 
-                if (sustainedTime >= SUSTAINED_TRIGGER_TIME && (millis() - lastAlertTime) > COOLDOWN_TIME) {
-                    Serial.printf("VOICE ALERT! Sustained for %lu ms, Peak: %d\n", sustainedTime, peak);
-                    
-                    // Reset voice detection
-                    sustainedTriggerActive = false;
-                    consecutiveTriggersCount = 0;
-                    
-                    // Set voice alert flag
-                    lastAlertType = VOICE_ALERT;
-                    currentState = ALERT_TRIGGERED;
-                    
-                    // Optional: Record audio
-                    recordingCounter++;
-                    String filename = "/voice_alert_" + String(recordingCounter) + ".wav";
-                    // You can add recording function here if needed
-                    // startTriggeredRecording();
-                }
-            }
-        } else {
-            if (sustainedTriggerActive) {
-                sustainedTriggerActive = false;
-                consecutiveTriggersCount = 0;
+                // The controller applies the cooldown
+                triggerPost(voiceSource(), TRIGGER_SCORE_CERTAIN, frame->timestamp_us);
             }
-        }
+            break;
+        default:
+            break;
     }
 }
 
+// Controller task. Returns once the clip is open; capture and SD writes
+// then run on their own tasks while alerts and monitoring carry on.
 void startTriggeredRecording() {
-  currentState = RECORDING;
+  if (!wavRecorderReady()) return;
+  if (wavRecorderBusy()) {
+    // A trigger during a clip is still alerted; the clip already covers it
+    Serial.println("Recording already in progress");
+    return;
+  }
+  
   lastTriggerTime = millis();
   recordingCounter++;
   
   Serial.printf("Starting recording #%d...\n", recordingCounter);
   
-  // Create filename with timestamp/counter
-  String filename = "/triggered_" + String(recordingCounter) + "_gain(" + String(RECORDING_GAIN) + ")_noise(" + String(RECORDING_NOISE_THRESHOLD) + ").wav";
-  
-  // Start recording
-  record_wav(RECORDING_GAIN, RECORDING_NOISE_THRESHOLD, filename.c_str());
-  
-  Serial.printf("Recording #%d complete. Saved as: %s\n", recordingCounter, filename.c_str());
-  Serial.println("Returning to monitoring...");
-  
-  currentState = IDLE; // Brief pause before returning to monitoring
+  // Start recording; the catalog names the file, straight into the path the
+  // transfer service offers once the clip is closed, and the writer task
+  // streams it to SD in the background
+  AudioLevelConfig levels = audioLevelConfig();
+  int16_t gate = audioGateThreshold();
+  if (record_wav(levels.agcMaxGain, gate, recordingPath, sizeof(recordingPath))) {
+    fixedLog(Serial, "Recording #%d streaming to %s (gain %u, noise %d)\n", recordingCounter, recordingPath,
+             levels.agcMaxGain, gate);
+  }
+}
+
+// Runs on whichever task applied the change; only copies values out
+void onConfigChanged(const AppConfig &config) {
+    voiceDetector = config.detector;
+    triggerSetCooldown(TRIGGER_SRC_AUDIO_PEAK, config.cooldownMs);
+    triggerSetCooldown(TRIGGER_SRC_AUDIO_CLASSIFIER, config.cooldownMs);
 }
 
 // BLE Callbacks
 class myServerCallbacks: public BLEServerCallbacks {
     void onConnect(BLEServer* pServer) {
-        deviceConnected = true;
-        Serial.println("Device Connected!");
+        xEventGroupSetBits(appEventGroup, APP_BIT_CONNECTED);
+        postAppEvent(APP_EVT_CONNECT);
+    }
+    
+    void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t *param) {
+        bleLinkOnConnect(param);
     }
     
     void onDisconnect(BLEServer* pServer) {
-        deviceConnected = false;
-        Serial.println("Device Disconnected!");
+        xEventGroupClearBits(appEventGroup, APP_BIT_CONNECTED);
+        bleLinkOnDisconnect();
+        bleXferOnDisconnect();
+        postAppEvent(APP_EVT_DISCONNECT);
+    }
+    
+    void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t *param) {
+        bleLinkOnMtuChanged(param);
+        fixedLog(Serial, "MTU negotiated: %u\n", param->mtu.mtu);
     }
 };
 
 class myRxCallbacks: public BLECharacteristicCallbacks {
     void onWrite(BLECharacteristic *pRxCharacteristic) {
-        std::string rxValue = pRxCharacteristic->getValue();
-        if (rxValue.length() > 0) {
-            Serial.print("Received From App: ");
-            Serial.println(rxValue.c_str());
-        }
+        // Binary commands, answered on TX by the controller (command_protocol.h)
+        // getData() reads the stored value in place; getValue() would copy it
+        commandOnWrite(pRxCharacteristic->getData(), pRxCharacteristic->getLength());
     }
 };
 
 // Alert sending function
-void sendAlert(AlertType alertType) {
-    if (!deviceConnected) {
-        Serial.println("No device connected - cannot send alert");
-        return;
+void sendAlert(AlertFrameType alertType, uint8_t flags) {
+    TRACE(TRACE_ALERT_SEND, alertType);
+    bool connected = isConnected();
+    if (!connected) {
+        pinLatencyStartUs = 0;        // Waiting for a connection isn't path latency
     }
     
-    lastAlertTime = millis();
-    currentState = SENDING_ALERT;
-    
-    String alertMessage;
-    if (alertType == VOICE_ALERT) {
-        alertMessage = "VOICE ALERT DETECTED!\n";
+    if (alertType == ALERT_FRAME_VOICE) {
         Serial.println("Sending VOICE ALERT via BLE");
-        voiceTriggerInterrupt();
-    } else {
-        alertMessage = "EMERGENCY BUTTON PRESSED!\n";
+    } else if (alertType == ALERT_FRAME_PIN) {
         Serial.println("Sending PIN ALERT via BLE");
+    } else if (alertType == ALERT_FRAME_MOTION) {
+        Serial.println("Sending MOTION ALERT via BLE");
+    } else {
+        Serial.println("Sending TEST ALERT via BLE");
     }
     
-    // Send initial alert
-    pTxCharacteristic->setValue(alertMessage.c_str());
-    pTxCharacteristic->notify();
-    delay(100);
+    // One frame carries the alert type and GPS fix; the log keeps it until
+    // the app acks, the TX task paces the notify
+    uint8_t frame[ALERT_FRAME_SIZE];
+    heapAlertBegin();
+    size_t frameLen = gps_alert_frame(alertType, flags, frame);
     
-    // Send GPS data
-    String gpsData = gps_data();
-    pTxCharacteristic->setValue(gpsData.c_str());
-    pTxCharacteristic->notify();
-    delay(100);
-    
-    Serial.println("Alert sent successfully!");
-    currentState = IDLE;
+    alertLogAppend(frame, frameLen, connected);
+    if (!connected) alertBeaconStart(frame, frameLen);
+    heapAlertEnd();
+    if (connected) {
+        Serial.println("Alert queued for sending");
+    } else {
+        Serial.println("No device connected - alert stored for replay and beaconed");
+    }
 }
 
 
-void record_wav(int gain, int threshold, const char* filename) {
-  uint32_t record_size = (SAMPLE_RATE * SAMPLE_BITS / 8) * RECORD_TIME;
-  uint8_t *rec_buffer = (uint8_t *)ps_malloc(record_size);
-  if (rec_buffer == NULL) {
-    Serial.println("PSRAM malloc failed!");
-    currentState = IDLE;
-    return;
+bool record_wav(int gain, int threshold, char *path, size_t pathSize) {
+  WavRecordingOptions options;
+  options.durationMs = appConfig().recordSeconds * 1000UL;
+  options.prerollMs = PREROLL_TIME_MS;
+  options.gain = gain;
+  options.noiseThreshold = threshold;
+  options.agcTargetPeak = audioLevelConfig().agcTargetPeak;
+  options.codec = RECORDING_CODEC;
+
+  // Catalog entry first: it makes room on the card and carries where and
+  // when the clip was taken
+  CatalogClip meta = {};
+  meta.utc = gpsClockUtcNow();
+  meta.codec = options.codec;
+  GpsPosition position;
+  xSemaphoreTake(gpsMutex, portMAX_DELAY);
+  bool havePosition = gpsFixCacheEstimate(position);
+  xSemaphoreGive(gpsMutex);
+  if (havePosition) {
+    meta.lat_e7 = position.fix.lat_e7;
+    meta.lng_e7 = position.fix.lng_e7;
+    meta.flags = CATALOG_FLAG_FIX;
   }
-
-  File file = SD.open(filename, FILE_WRITE);
-  if (!file) {
-    Serial.println("Failed to create WAV file!");
-    free(rec_buffer);
-    currentState = IDLE;
-    return;
+  recordingId = catalogCreate(meta, wavRecorderExpectedBytes(options), path, pathSize);
+  if (recordingId == 0) {
+    Serial.println("Recording catalog unavailable");
+    return false;
   }
-
-  uint8_t wav_header[WAV_HEADER_SIZE];
-  generate_wav_header(wav_header, record_size, SAMPLE_RATE);
-  file.write(wav_header, WAV_HEADER_SIZE);
-
-  size_t bytesRead = 0;
-  esp_i2s::i2s_read(esp_i2s::I2S_NUM_0, rec_buffer, record_size, &bytesRead, portMAX_DELAY);
-  if (bytesRead == 0) {
-    Serial.println("Recording failed.");
-    free(rec_buffer);
-    file.close();
-    currentState = IDLE;
-    return;
+  if (!wavRecorderStart(path, options)) {
+    catalogCancel(recordingId);
+    recordingId = 0;
+    return false;
   }
+  return true;
+}
 
-  // Apply gain and noise gate
-  for (uint32_t i = 0; i < bytesRead; i += 2) {
-    int16_t *sample = (int16_t *)(rec_buffer + i);
-    if (abs(*sample) < threshold) {
-      *sample = 0;
-    } else {
-      *sample = constrain((*sample) * gain, -32768, 32767);
-    }
-  }
 
-  if (file.write(rec_buffer, bytesRead) != bytesRead) {
-    Serial.println("Write error!");
-  }
+// Boot steps, each on its own task (boot_sequence.h); the controller
+// finishes what depends on more than one in actionBootStage()
 
-  free(rec_buffer);
-  file.close();
+// 115200 baud, RMC + GGA (or NAV-PVT), parsed on its own task. The
+// receiver's baud switch waits on the UART for ~300ms.
+bool beginGps() {
+    if (!gpsIngestBegin(GPS_SERIAL_PORT, GPS_RX_PIN, GPS_TX_PIN, gps, gpsMutex, GPS_PROTOCOL)) {
+        fixedLog(Serial, "Failed to start GPS task\n");
+        return false;
+    }
+    return true;
+}
+
+// Mount only (bus and pins in sd_storage.h); the catalog and alert log
+// load on the controller, which owns them
+bool beginStorage() {
+    bool ok = sdStorageBegin();
+    fixedLog(Serial, "%s\n", ok ? "SD Card initialized" : "SD Card initialization failed - voice recording disabled");
+    return ok;
 }
 
+// I2S, pre-roll history and the capture and detector tasks. Up means the
+// voice triggers are armed; recording also needs storage.
+bool beginAudio() {
+    I2S.setAllPins(-1, 42, 41, -1, -1);
+    if (!I2S.begin(PDM_MONO_MODE, SAMPLE_RATE, SAMPLE_BITS)) {
+        fixedLog(Serial, "I2S initialization failed - voice trigger disabled\n");
+        return false;
+    }
+    fixedLog(Serial, "I2S initialized\n");
+    
+    // Pre-roll history lives in PSRAM; without it recording is disabled
+    if (!audioHistoryBegin(PREROLL_TIME_MS + HISTORY_MARGIN_MS)) {
+        fixedLog(Serial, "Failed to allocate audio history - voice recording disabled\n");
+    }
+    
+    // Capture task streams I2S frames into the detector ring
+    audioCaptureSetAnalyzer(analyzeVoiceFrame);
+    if (!audioCaptureBegin()) {
+        fixedLog(Serial, "Failed to start audio capture task\n");
+        return false;
+    }
+    uint32_t cooldown = appConfig().cooldownMs;
+    triggerRegister(TRIGGER_SRC_AUDIO_PEAK, {"audio peak", ALERT_FRAME_VOICE, TRIGGER_SCORE_CERTAIN, cooldown, true});
+    triggerRegister(TRIGGER_SRC_AUDIO_CLASSIFIER,
+                    {"audio classifier", ALERT_FRAME_VOICE, TRIGGER_SCORE_CERTAIN, cooldown, true});
+    wavRecorderSetDoneCallback(recorderDone);
+    xTaskCreatePinnedToCore(detectorTask, "detector", DETECTOR_TASK_STACK, NULL, DETECTOR_TASK_PRIORITY,
+                            NULL, DETECTOR_TASK_CORE);
+    fixedLog(Serial, "Voice monitoring enabled\n");
+    return true;
+}
 
-void generate_wav_header(uint8_t *wav_header, uint32_t wav_size, uint32_t sample_rate) {
-  uint32_t file_size = wav_size + WAV_HEADER_SIZE - 8;
-  uint32_t byte_rate = SAMPLE_RATE * SAMPLE_BITS / 8;
-  const uint8_t set_wav_header[] = {
-    'R', 'I', 'F', 'F',
-    file_size, file_size >> 8, file_size >> 16, file_size >> 24,
-    'W', 'A', 'V', 'E',
-    'f', 'm', 't', ' ',
-    0x10, 0x00, 0x00, 0x00,
-    0x01, 0x00,
-    0x01, 0x00,
-    sample_rate, sample_rate >> 8, sample_rate >> 16, sample_rate >> 24,
-    byte_rate, byte_rate >> 8, byte_rate >> 16, byte_rate >> 24,
-    0x02, 0x00,
-    0x10, 0x00,
-    'd', 'a', 't', 'a',
-    wav_size, wav_size >> 8, wav_size >> 16, wav_size >> 24,
-  };
-  memcpy(wav_header, set_wav_header, sizeof(set_wav_header));
+// Optional accelerometer: fall and shake sources on their own task
+bool beginImu() {
+    return imuDetectorBegin();
 }
 
 void setup() {
     Serial.begin(115200);
-    delay(50);
     
-    // Initialize GPS
-    Serial1.begin(9600, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
-    delay(200);
-    changeBaudrate();
-    Serial1.begin(115200, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
+    // Queues and event bits exist before any callback or ISR can use them
+    appEventQueue = xQueueCreate(APP_EVENT_QUEUE_DEPTH, sizeof(AppEvent));
+    appEventGroup = xEventGroupCreate();
+    gpsMutex = xSemaphoreCreateMutex();
+    bootBegin(appEventQueue);
+    const esp_timer_create_args_t holdTimerArgs = {holdTimerExpired, nullptr, ESP_TIMER_TASK, "alert_hold"};
+    esp_timer_create(&holdTimerArgs, &holdTimer);
+    
+    // Saved settings (NVS) before anything reads them
+    appConfigBegin(onConfigChanged);
+    triggerBegin(appEventQueue);
+    if (!commandBegin(appEventQueue)) {
+        Serial.println("Failed to create command queue");
+    }
+    powerBegin();
+    
+    // The button first: an alert from here on is kept in RAM, and goes out
+    // (or is beaconed) once BLE is up; SD is attached when it mounts
+    alertLogBegin();
+    xTaskCreatePinnedToCore(controllerTask, "controller", CONTROLLER_TASK_STACK, NULL,
+                            CONTROLLER_TASK_PRIORITY, NULL, CONTROLLER_TASK_CORE);
+    triggerRegister(TRIGGER_SRC_BUTTON, {"button", ALERT_FRAME_PIN, TRIGGER_SCORE_CERTAIN, PIN_DEBOUNCE_MS, true});
+    pinMode(TRIGGER_PIN, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(TRIGGER_PIN), pinTriggerActivated, FALLING);
+    bootMark(BOOT_STAGE_ARMED, true);
     
     // Initialize BLE
     Serial.println("Starting SHIELD Alert System!");
@@ -381,115 +466,337 @@ void setup() {
     // BLEDevice::setPower(ESP_PWR_LVL_P9, ESP_BLE_PWR_TYPE_DEFAULT);
     pServer = BLEDevice::createServer();
     pServer->setCallbacks(new myServerCallbacks());
+    bleLinkBegin(pServer);
     
     BLEService *pService = pServer->createService(SERVICE_UUID);
     pTxCharacteristic = pService->createCharacteristic(CHARACTERISTIC_UUID_TX, BLECharacteristic::PROPERTY_NOTIFY);
     pTxCharacteristic->addDescriptor(new BLE2902());
     pRxCharacteristic = pService->createCharacteristic(CHARACTERISTIC_UUID_RX, BLECharacteristic::PROPERTY_WRITE);
     pRxCharacteristic->setCallbacks(new myRxCallbacks());
+    bool bleReady = bleTxBegin(pTxCharacteristic);
+    if (!bleReady) {
+        Serial.println("Failed to start BLE TX task");
+    }
+    pXferCharacteristic = pService->createCharacteristic(CHARACTERISTIC_UUID_XFER,
+        BLECharacteristic::PROPERTY_NOTIFY | BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR);
+    pXferCharacteristic->addDescriptor(new BLE2902());
+    if (!bleXferBegin(pXferCharacteristic)) {
+        Serial.println("Failed to start clip transfer task");
+    }
     
     pService->start();
-    BLEAdvertising *pAdvertising = BLEDevice::getAdvertising();
-    pAdvertising->addServiceUUID(SERVICE_UUID);
-    pAdvertising->setScanResponse(true);
-    pAdvertising->setMinPreferred(0x06);
-    pAdvertising->setMinPreferred(0x12);
+    // Service UUID and name, or the alert beacon while an alert waits for a connection
+    alertBeaconBegin(BLEDevice::getAdvertising(), "SHIELD", SERVICE_UUID);
     BLEDevice::startAdvertising();
+    bleTxEnqueueText(BLE_TX_STATUS, "SHIELD Alert System Online");
+    bootMark(BOOT_STAGE_BLE, bleReady);
     
-    // Initialize SD Card for voice recording
-    if (!SD.begin(SD_CS)) {
-        Serial.println("SD Card initialization failed - voice recording disabled");
-    } else {
-        Serial.println("SD Card initialized");
-    }
+    // The slow ones in parallel: the GPS baud switch, the SD mount (and its
+    // timeouts without a card), I2S and the IMU probe
+    bootStartStep(BOOT_STAGE_GPS, beginGps);
+    bootStartStep(BOOT_STAGE_STORAGE, beginStorage);
+    bootStartStep(BOOT_STAGE_AUDIO, beginAudio);
+    bootStartStep(BOOT_STAGE_IMU, beginImu);
     
-    // Initialize I2S for voice monitoring
-    I2S.setAllPins(-1, 42, 41, -1, -1);
-    if (!I2S.begin(PDM_MONO_MODE, SAMPLE_RATE, SAMPLE_BITS)) {
-        Serial.println("I2S initialization failed - voice trigger disabled");
-    } else {
-        Serial.println("I2S initialized");
-        
-        // Allocate monitoring buffer
-        monitor_buffer = (uint8_t *)malloc(MONITOR_BUFFER_SIZE);
-        if (monitor_buffer != NULL) {
-            // Setup timer for voice monitoring
-            timer = timerBegin(0, 80, true);
-            timerAttachInterrupt(timer, &onTimer, true);
-            timerAlarmWrite(timer, 50000, true);  // 50ms interval
-            timerAlarmEnable(timer);
-            Serial.println("Voice monitoring enabled");
-        } else {
-            Serial.println("Failed to allocate voice monitoring buffer");
-        }
-    }
+#ifdef DSP_BENCHMARK
+    dspBenchmark(Serial);
+    voiceClassifierBenchmark(Serial);
+#endif
+}
+
+// Guards and actions for the controller table; controller task only
+
+// The fusion stage: every trigger event passes through here exactly once
+bool triggerFused(const AppEvent &event) {
+    return triggerFuse(event, lastDecision);
+}
+
+// A timer armed before the hold was re-entered can still fire; only the
+// current deadline ends the hold
+bool holdElapsed(const AppEvent &event) {
+    return event.timestamp_us >= holdUntilUs;
+}
+
+void raiseAlert(AlertFrameType alertType, uint8_t flags, bool record) {
+    // Alerts get the fast connection profile and GPS rate; both relax once they are done
+    bleLinkBoost();
+    gpsBoost();
+    powerOnAlert();
     
-    // Setup pin trigger
-    pinMode(TRIGGER_PIN, INPUT_PULLUP);
-    attachInterrupt(digitalPinToInterrupt(TRIGGER_PIN), pinTriggerActivated, FALLING);
+    // The alert is queued (and on its way from the TX task) before the SD
+    // work of opening a clip starts. Pre-roll comes out of history, so the
+    // clip still starts PREROLL_TIME_MS before the trigger.
+    sendAlert(alertType, flags);
+    if (record) startTriggeredRecording();
+}
+
+void actionTrigger(const AppEvent &event) {
+    const TriggerDecision &d = lastDecision;
+    if (d.source == TRIGGER_SRC_BUTTON) {
+        pinLatencyStartUs = event.timestamp_us;
+        Serial.println("Pin trigger activated!");
+    }
+    if (d.sources > 1) {
+        fixedLog(Serial, "Fused trigger: %u detectors, led by source %u (score %u)\n", d.sources, d.source, d.score);
+    }
+    raiseAlert(d.alertType, d.sources > 1 ? FRAME_FLAG_FUSED : 0, d.record);
+}
+
+void actionTestAlert(const AppEvent &event) {
+    Serial.println("Test alert requested");
+    raiseAlert(ALERT_FRAME_TEST, 0, false);
+}
+
+void actionRecordingDone(const AppEvent &event) {
+    fixedLog(Serial, "Recording #%d complete (%u bytes, encoder load %.2f%%)\n", recordingCounter,
+                     (unsigned)wavRecorderLastDataBytes(), wavRecorderEncodeLoad());
+    SdStorageStats sd = sdStorageStats();
+    catalogFinish(recordingId, sd.lastFileBytes, wavRecorderLastDurationMs());
+    CatalogStats catalog = catalogStats();
+    fixedLog(Serial, "SD: slowest write %lu us, %u recordings in %lu KB, %lu pruned\n",
+             (unsigned long)sd.lastMaxWriteUs, catalog.clips,
+             (unsigned long)(catalog.bytes / 1024), (unsigned long)catalog.pruned);
+    // Offered to the app now; the catalog keeps it pending until uploaded
+    bleXferClipReady(recordingPath);
+}
+
+void actionConnect(const AppEvent &event) {
+    Serial.println("Device Connected!");
+    alertBeaconOnConnect();
+}
+
+void actionDisconnect(const AppEvent &event) {
+    Serial.println("Device Disconnected!");
+    alertBeaconOnDisconnect();
+}
+
+void actionCommand(const AppEvent &event) {
+    commandProcess();
+}
+
+// The catalog and the alert log are the controller's, so SD attaches here
+void attachStorage(bool sdReady) {
+    // Recordings index: ids, metadata and upload state across resets
+    catalogBegin(sdReady);
+    CatalogStats catalogLoaded = catalogStats();
+    if (sdReady) {
+        fixedLog(Serial, "Recording catalog: %u clips, %lu KB, %lu bad records skipped\n", catalogLoaded.clips,
+                 (unsigned long)(catalogLoaded.bytes / 1024), (unsigned long)catalogLoaded.badRecords);
+    }
     
+    // Alerts not acked before a reset or dropout are replayed on the next connection
+    alertLogAttach(sdReady);
+    AlertLogStats logStats = alertLogStats();
+    if (logStats.pending > 0 || logStats.badRecords > 0) {
+        fixedLog(Serial, "Alert log: %u pending, %lu bad records skipped\n", logStats.pending,
+                 (unsigned long)logStats.badRecords);
+    }
+}
+
+void printReady() {
     Serial.println("SHIELD Alert System Ready!");
     Serial.println("- Pin trigger on pin 1");
-    Serial.println("- Voice trigger monitoring active");
+    if (bootStageOk(BOOT_STAGE_IMU)) Serial.println("- Motion trigger (fall/shake) on the I2C accelerometer");
+    if (bootStageOk(BOOT_STAGE_AUDIO)) {
+        Serial.printf("- Voice trigger monitoring active (%s detector)\n",
+                      voiceDetector == DETECTOR_CLASSIFIER ? "spectral" : "peak");
+    }
     Serial.println("- BLE advertising as 'SHIELD_ALERT'");
-    
-    pTxCharacteristic->setValue("SHIELD Alert System Online");
-    pTxCharacteristic->notify();
-    
-    currentState = MONITORING;
+    bootPrintReport(Serial);
 }
 
-void loop() {
-    // Process GPS data
-    while (Serial1.available() > 0) {
-        gps.encode(Serial1.read());
+// Stages can finish in any order and a flag can be set before its event
+// arrives, so dependent work keys off what this task has already done
+void actionBootStage(const AppEvent &event) {
+    static bool storageAttached = false;
+    static bool readyReported = false;
+    if (event.source == BOOT_STAGE_STORAGE) {
+        attachStorage(event.score != 0);
+        storageAttached = event.score != 0;
     }
     
-    // Handle voice trigger interrupt
-    if (voiceTriggerDetected) {
-        portENTER_CRITICAL(&timerMux);
-        voiceTriggerDetected = false;
-        portEXIT_CRITICAL(&timerMux);
-        voiceTriggerInterrupt();
+    // The recorder needs the catalog and the pre-roll history
+    if ((event.source == BOOT_STAGE_STORAGE || event.source == BOOT_STAGE_AUDIO) && storageAttached &&
+        bootStageOk(BOOT_STAGE_AUDIO) && !wavRecorderReady() && !wavRecorderBegin()) {
+        Serial.println("Failed to start recorder task");
     }
-    
-    // Handle pin trigger
-    if (pinTriggered) {
-        pinTriggered = false;
-        currentState = ALERT_TRIGGERED;
-        Serial.println("Pin trigger activated!");
+    if (!readyReported && bootComplete()) {
+        readyReported = true;
+        printReady();
     }
-    
-    // State machine
-    switch (currentState) {
-        case MONITORING:
-            // Send periodic status if connected
-            if (deviceConnected) {
-                static unsigned long lastStatus = 0;
-                if (millis() - lastStatus > 1000) { // Every 10 seconds
-                    pTxCharacteristic->setValue("System monitoring - All OK");
-                    pTxCharacteristic->notify();
-                    lastStatus = millis();
-                }
-            }
-            break;
-            
-        case ALERT_TRIGGERED:
-            // Send alert based on trigger type
+}
 
-            sendAlert(lastAlertType);
-            break;
-            
-        case SENDING_ALERT:
-            // Handled in sendAlert function
-            break;
-            
-        case IDLE:
-            // Brief pause before returning to monitoring
-            delay(100);
-            currentState = MONITORING;
-            break;
+// Every state change the controller makes, in priority order. Detector
+// events are fused in every state (the detector task itself only runs
+// during MONITORING) and test alerts are always taken. An alert holds for
+// ALERT_HOLD_MS before monitoring resumes. A clip in progress changes none
+// of this; its completion is handled in any state.
+const SmTransition controllerTable[] = {
+    // state       event                       next          guard            action
+    {SM_ANY,       APP_EVT_TRIGGER,            ALERT_HOLD,   triggerFused,    actionTrigger},
+    {SM_ANY,       APP_EVT_TEST,               ALERT_HOLD,   nullptr,         actionTestAlert},
+    {ALERT_HOLD,   APP_EVT_HOLD_EXPIRED,       MONITORING,   holdElapsed,     nullptr},
+    {SM_ANY,       APP_EVT_RECORDING_DONE,     SM_STAY,      nullptr,         actionRecordingDone},
+    {SM_ANY,       APP_EVT_CONNECT,            SM_STAY,      nullptr,         actionConnect},
+    {SM_ANY,       APP_EVT_DISCONNECT,         SM_STAY,      nullptr,         actionDisconnect},
+    {SM_ANY,       APP_EVT_COMMAND,            SM_STAY,      nullptr,         actionCommand},
+    {SM_ANY,       APP_EVT_BOOT_STAGE,         SM_STAY,      nullptr,         actionBootStage},
+};
+
+// The detector sees MONITORING through the event group
+void onEnterState(uint8_t state) {
+    if (state == MONITORING) {
+        xEventGroupSetBits(appEventGroup, APP_BIT_MONITORING);
+    } else {
+        xEventGroupClearBits(appEventGroup, APP_BIT_MONITORING);
+    }
+    if (state == ALERT_HOLD) {
+        holdUntilUs = esp_timer_get_time() + ALERT_HOLD_MS * 1000LL;
+        esp_timer_stop(holdTimer);
+        esp_timer_start_once(holdTimer, ALERT_HOLD_MS * 1000ULL);
+    }
+}
+
+StateMachine controller = {controllerTable, sizeof(controllerTable) / sizeof(controllerTable[0]), onEnterState};
+
+// esp_timer task and BLE callbacks: hand the event over, never block
+void postAppEvent(AppEventType type) {
+    AppEvent event = {type, esp_timer_get_time()};
+    xQueueSend(appEventQueue, &event, 0);
+}
+
+// The hold deadline is also checked every controller pass, so a full queue
+// only delays the end of the hold by one tick
+void holdTimerExpired(void *arg) {
+    postAppEvent(APP_EVT_HOLD_EXPIRED);
+}
+
+// The bit is what counts; the event only wakes the controller early
+void recorderDone() {
+    xEventGroupSetBits(appEventGroup, APP_BIT_RECORDING_DONE);
+    postAppEvent(APP_EVT_RECORDING_DONE);
+}
+
+// Events that must not be lost to a full queue come from state, not from the
+// queue: the recorder's bit and the hold deadline. Controller task only.
+void dispatchPendingEvents() {
+    int64_t nowUs = esp_timer_get_time();
+    if (xEventGroupClearBits(appEventGroup, APP_BIT_RECORDING_DONE) & APP_BIT_RECORDING_DONE) {
+        smDispatch(controller, {APP_EVT_RECORDING_DONE, nowUs});
+    }
+    if (controller.state == ALERT_HOLD && nowUs >= holdUntilUs) {
+        smDispatch(controller, {APP_EVT_HOLD_EXPIRED, nowUs});
+    }
+}
+
+// Snapshot for status_report; called every controller pass, so cheap reads only
+StatusFrame currentStatus() {
+    StatusFrame status;
+    if (controller.state == ALERT_HOLD) {
+        status.mode = STATUS_MODE_ALERTING;
+    } else if (wavRecorderBusy()) {
+        status.mode = STATUS_MODE_RECORDING;      // Still monitoring underneath
+    } else {
+        status.mode = STATUS_MODE_MONITORING;
     }
+    if (powerState() == POWER_LOW) status.mode |= STATUS_MODE_LOW_POWER;
+    status.batteryPct = powerBatteryPercent();
     
-    delay(10);
-}
\ No newline at end of file
+    GpsPosition position;
+    xSemaphoreTake(gpsMutex, portMAX_DELAY);
+    bool havePosition = gpsFixCacheEstimate(position);
+    xSemaphoreGive(gpsMutex);
+    status.gpsFlags = 0;
+    status.sats = havePosition ? position.fix.sats : 0;
+    if (havePosition) status.gpsFlags |= STATUS_GPS_FIX_CACHED;
+    if (havePosition && position.fresh) status.gpsFlags |= STATUS_GPS_FIX_FRESH;
+    if (gpsClockUtcNow() != 0) status.gpsFlags |= STATUS_GPS_CLOCK;
+    if (gpsPowerState() == GPS_POWER_BACKUP) status.gpsFlags |= STATUS_GPS_BACKUP;
+    
+    float floorDb = audioNoiseFloorDb();
+    status.noiseFloorDb = (int8_t)(floorDb < -127 ? -127 : lroundf(floorDb));
+    status.alertsPending = alertLogStats().pending;
+    return status;
+}
+
+// Close the pending pin measurement once the TX task reports the alert sent
+void updatePinLatency() {
+    if (pinLatencyStartUs == 0) return;
+    
+    int64_t sentUs = bleTxStats().lastAlertSentUs;
+    if (sentUs < pinLatencyStartUs) return;
+    
+    uint32_t latency = (uint32_t)(sentUs - pinLatencyStartUs);
+    pinLatencyStartUs = 0;
+    pinLatency.lastUs = latency;
+    pinLatency.samples++;
+    if (latency > pinLatency.maxUs) pinLatency.maxUs = latency;
+    if (latency > PIN_LATENCY_TARGET_US) pinLatency.overBudget++;
+    fixedLog(Serial, "Pin alert latency: %lu us (max %lu us, %lu of %lu over %u us)\n",
+                     (unsigned long)latency, (unsigned long)pinLatency.maxUs,
+                     (unsigned long)pinLatency.overBudget, (unsigned long)pinLatency.samples,
+                     (unsigned)PIN_LATENCY_TARGET_US);
+}
+
+// Runs the state machine: every transition is driven by an event on
+// appEventQueue, handled as soon as it arrives. Without events the task
+// wakes every CONTROLLER_TICK_MS for heartbeats and housekeeping only.
+void controllerTask(void *arg) {
+    smStart(controller, MONITORING);
+    
+    for (;;) {
+        AppEvent event;
+        if (xQueueReceive(appEventQueue, &event, pdMS_TO_TICKS(CONTROLLER_TICK_MS)) == pdTRUE) {
+            if (event.type == APP_EVT_TRIGGER && event.source == TRIGGER_SRC_BUTTON) buttonPending = false;
+            // Hold and recorder events are wake-ups; dispatchPendingEvents() acts on them
+            if (event.type != APP_EVT_HOLD_EXPIRED && event.type != APP_EVT_RECORDING_DONE) {
+                smDispatch(controller, event);
+            }
+        }
+        dispatchPendingEvents();
+        updatePinLatency();
+        
+        bleLinkPoll();
+        alertLogPoll(isConnected());
+        alertBeaconPoll(isConnected(), alertLogStats().pending);
+        powerPoll(controller.state != MONITORING || wavRecorderBusy() || bleXferActive());
+        
+        // Status goes out on change plus a slow keepalive, see status_report.h
+        uint32_t keepalive = appConfig().heartbeatMs;
+        if (powerState() == POWER_LOW && keepalive < POWER_KEEPALIVE_LOW_MS) keepalive = POWER_KEEPALIVE_LOW_MS;
+        statusReportPoll(currentStatus(), isConnected(), keepalive);
+        
+        // Binary trace dump on request from the console (tools/trace_histogram.py).
+        // Other tasks' lines are held off for the dump; a line already in the
+        // UART buffer drains first. CMD_GET_TRACE over BLE can't be interleaved.
+        while (Serial.available() > 0) {
+            if (Serial.read() != TRACE_SERIAL_DUMP_CHAR) continue;
+            fixedLogHold(true);
+            Serial.flush();
+            traceDump(Serial);
+            Serial.flush();
+            fixedLogHold(false);
+        }
+        
+        static unsigned long lastPowerReport = 0;
+        if (controller.state == MONITORING && millis() - lastPowerReport > POWER_REPORT_INTERVAL_MS) {
+            powerPrintReport(Serial);
+            heapStatsPrint(Serial);
+            triggerPrintReport(Serial);
+            fixedLog(Serial, "Status: %lu frames queued\n", (unsigned long)statusReportFramesSent());
+            uint32_t audioDropped = audioCaptureDroppedFrames();
+            if (audioDropped > 0) fixedLog(Serial, "Audio: %lu capture frames dropped\n", (unsigned long)audioDropped);
+            AlertBeaconStats beacon = alertBeaconStats();
+            if (beacon.bursts > 0) {
+                fixedLog(Serial, "Beacon: %lu bursts, %lu updates, %lu timed out\n", (unsigned long)beacon.bursts,
+                         (unsigned long)beacon.updates, (unsigned long)beacon.timedOut);
+            }
+            lastPowerReport = millis();
+        }
+    }
+}
+
+void loop() {
+    // Everything runs in the tasks started by setup()
+    vTaskDelete(NULL);
+}
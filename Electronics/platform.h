@@ -0,0 +1,10 @@
+// Platform layer for the modules that also build on the host (detection,
+// DSP, levels, formatting): Arduino on the device, host/host_platform.h in
+// the replay harness. Everything else may include Arduino.h directly.
+#pragma once
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include "host_platform.h"
+#endif
@@ -0,0 +1,165 @@
+#include "power_manager.h"
+#include "gps_ingest.h"
+#include "fixed_format.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+static volatile uint32_t lastSoundMs = 0;
+static volatile uint32_t framesGated = 0;
+static volatile PowerState state = POWER_ACTIVE;
+static uint32_t lastAlertMs = 0;
+static uint32_t lastPollMs = 0;
+static uint32_t gpsPhaseStartMs = 0;
+static bool gpsBackup = false;
+static PowerReport report = {};
+
+#if CONFIG_PM_ENABLE
+// Held while active so the PM driver keeps the CPU at full speed
+static esp_pm_lock_handle_t activeLock = NULL;
+#endif
+
+static void applyCpu(PowerState next) {
+#if CONFIG_PM_ENABLE
+    if (next == POWER_ACTIVE) {
+        esp_pm_lock_acquire(activeLock);
+    } else {
+        esp_pm_lock_release(activeLock);
+    }
+#else
+    setCpuFrequencyMhz(next == POWER_ACTIVE ? POWER_CPU_ACTIVE_MHZ : POWER_CPU_LOW_MHZ);
+#endif
+}
+
+static float gpsCurrent() {
+    switch (gpsPowerState()) {
+        case GPS_POWER_TRACKING: return POWER_MA_GPS_TRACKING;
+        case GPS_POWER_BACKUP:   return POWER_MA_GPS_BACKUP;
+        default:                 return POWER_MA_GPS_SAVE;
+    }
+}
+
+static void accumulate(uint32_t now) {
+    uint32_t dt = now - lastPollMs;
+    lastPollMs = now;
+    float mA = (state == POWER_ACTIVE ? POWER_MA_CPU_ACTIVE : POWER_MA_CPU_LOW) + gpsCurrent();
+    report.state[state].ms += dt;
+    report.state[state].mAh += mA * dt / 3600000.0f;
+}
+
+static void setGpsBackup(bool backup, uint32_t now) {
+    if (backup == gpsBackup) return;
+    gpsBackup = backup;
+    gpsPhaseStartMs = now;
+    gpsSetBackup(backup);
+}
+
+// In POWER_LOW alternate tracking and backup; otherwise keep it up
+static void pollGps(uint32_t now) {
+    if (state == POWER_ACTIVE) {
+        setGpsBackup(false, now);
+        return;
+    }
+    uint32_t phase = now - gpsPhaseStartMs;
+    if (!gpsBackup && phase >= POWER_GPS_ON_MS) {
+        setGpsBackup(true, now);
+    } else if (gpsBackup && phase >= POWER_GPS_BACKUP_MS) {
+        setGpsBackup(false, now);
+    }
+}
+
+void powerBegin() {
+#if CONFIG_PM_ENABLE
+    esp_pm_config_esp32s3_t pm = {};
+    pm.max_freq_mhz = POWER_CPU_ACTIVE_MHZ;
+    pm.min_freq_mhz = POWER_CPU_LOW_MHZ;
+    pm.light_sleep_enable = true;
+    esp_pm_configure(&pm);
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "active", &activeLock);
+#endif
+    uint32_t now = millis();
+    lastPollMs = now;
+    lastAlertMs = now;                // Stay up for the first hold after boot
+    gpsPhaseStartMs = now;
+    state = POWER_ACTIVE;
+    applyCpu(POWER_ACTIVE);
+}
+
+bool powerFrameWanted(int16_t peak) {
+    if (peak >= POWER_SOUND_FLOOR) {
+        lastSoundMs = millis();
+        return true;
+    }
+    if (state == POWER_ACTIVE) return true;
+    framesGated++;
+    return false;
+}
+
+void powerOnAlert() {
+    lastAlertMs = millis();
+}
+
+void powerPoll(bool busy) {
+    uint32_t now = millis();
+    accumulate(now);
+
+    PowerState next = POWER_ACTIVE;
+#if POWER_LOW_POWER_ENABLED
+    bool recentSound = now - lastSoundMs < POWER_SOUND_HOLD_MS;
+    bool recentAlert = now - lastAlertMs < POWER_ALERT_HOLD_MS;
+    if (!busy && !recentSound && !recentAlert) {
+        next = POWER_LOW;
+    }
+    if (state == POWER_LOW && next == POWER_ACTIVE && recentSound) {
+        report.soundWakes++;
+    }
+#endif
+    if (next != state) {
+        applyCpu(next);
+        state = next;
+    }
+    pollGps(now);
+}
+
+PowerState powerState() {
+    return state;
+}
+
+uint8_t powerBatteryPercent() {
+#if POWER_BATTERY_ADC_PIN >= 0
+    int32_t mv = (int32_t)analogReadMilliVolts(POWER_BATTERY_ADC_PIN) * POWER_BATTERY_DIVIDER;
+    int32_t pct = (mv - POWER_BATTERY_EMPTY_MV) * 100 / (POWER_BATTERY_FULL_MV - POWER_BATTERY_EMPTY_MV);
+    pct = pct < 0 ? 0 : (pct > 100 ? 100 : pct);
+    return (uint8_t)(pct / POWER_BATTERY_STEP_PCT * POWER_BATTERY_STEP_PCT);
+#else
+    return 255;
+#endif
+}
+
+PowerReport powerReport() {
+    PowerReport r = report;
+    r.framesGated = framesGated;
+    return r;
+}
+
+void powerPrintReport(Print &out) {
+    PowerReport r = powerReport();
+    static const char *const names[POWER_STATE_COUNT] = {"active", "low"};
+    uint32_t totalMs = 0;
+    float totalMah = 0;
+    for (int i = 0; i < POWER_STATE_COUNT; i++) {
+        totalMs += r.state[i].ms;
+        totalMah += r.state[i].mAh;
+    }
+    for (int i = 0; i < POWER_STATE_COUNT; i++) {
+        float hours = r.state[i].ms / 3600000.0f;
+        fixedLog(out, "Power %-6s %8lu s  %7.2f mAh  avg %5.1f mA\n", names[i],
+                 (unsigned long)(r.state[i].ms / 1000), r.state[i].mAh,
+                 hours > 0 ? r.state[i].mAh / hours : 0.0f);
+    }
+    float totalHours = totalMs / 3600000.0f;
+    fixedLog(out, "Power total  %8lu s  %7.2f mAh  avg %5.1f mA  (%lu sound wakes, %lu frames gated)\n",
+             (unsigned long)(totalMs / 1000), totalMah,
+             totalHours > 0 ? totalMah / totalHours : 0.0f,
+             (unsigned long)r.soundWakes, (unsigned long)r.framesGated);
+}
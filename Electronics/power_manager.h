@@ -0,0 +1,83 @@
+// Power management: CPU clock, sound-gated analysis, GPS duty cycle and a
+// per-state energy estimate
+#pragma once
+
+#include <Arduino.h>
+
+// 0 keeps the device in POWER_ACTIVE permanently
+#define POWER_LOW_POWER_ENABLED 1
+
+// POWER_ACTIVE while anything is happening, POWER_LOW otherwise. With
+// CONFIG_PM_ENABLE the low state also allows automatic light sleep between
+// DMA bursts; without it the CPU clock is simply lowered.
+#define POWER_CPU_ACTIVE_MHZ    240
+#define POWER_CPU_LOW_MHZ       80
+
+// Frame peak (raw PCM) that counts as sound. In POWER_LOW only frames above
+// this run the classifier; quieter ones are rejected on the peak alone.
+#define POWER_SOUND_FLOOR       600
+#define POWER_SOUND_HOLD_MS     10000 // Stay active this long after sound ...
+#define POWER_ALERT_HOLD_MS     30000 // ... or after an alert
+
+// GPS duty cycle in POWER_LOW: track long enough to refresh the fix cache,
+// then backup. Alerts boost it straight back to tracking.
+#define POWER_GPS_ON_MS         120000
+#define POWER_GPS_BACKUP_MS     600000
+
+#define POWER_KEEPALIVE_LOW_MS    60000 // Status keepalive floor in low power
+#define POWER_REPORT_INTERVAL_MS  60000
+
+// Battery sense through a divider on an ADC pin; -1 when not wired.
+// Reported in POWER_BATTERY_STEP_PCT steps so ADC noise doesn't flap.
+#define POWER_BATTERY_ADC_PIN   -1
+#define POWER_BATTERY_DIVIDER   2
+#define POWER_BATTERY_EMPTY_MV  3300
+#define POWER_BATTERY_FULL_MV   4150
+#define POWER_BATTERY_STEP_PCT  5
+
+// Current model in mA at the battery, per CPU state and GPS state. These
+// are datasheet-level starting points; calibrate against a meter.
+#define POWER_MA_CPU_ACTIVE     48.0f // 240 MHz, I2S + BLE connected
+#define POWER_MA_CPU_LOW        24.0f // 80 MHz, I2S + BLE connected
+#define POWER_MA_GPS_TRACKING   25.0f
+#define POWER_MA_GPS_SAVE       11.0f
+#define POWER_MA_GPS_BACKUP     0.03f
+
+enum PowerState {
+    POWER_ACTIVE,
+    POWER_LOW,
+    POWER_STATE_COUNT
+};
+
+struct PowerStateStats {
+    uint32_t ms;                      // Time spent in the state
+    float mAh;                        // Estimated charge used in it
+};
+
+struct PowerReport {
+    PowerStateStats state[POWER_STATE_COUNT];
+    uint32_t soundWakes;              // POWER_LOW -> POWER_ACTIVE on sound
+    uint32_t framesGated;             // Frames rejected below POWER_SOUND_FLOOR
+};
+
+// Configure frequency scaling and start in POWER_ACTIVE. Call once from
+// setup() after gpsIngestBegin().
+void powerBegin();
+
+// Capture task, per frame: true if the frame deserves full analysis. Frames
+// above POWER_SOUND_FLOOR also count as sound for the hold. Must not block.
+bool powerFrameWanted(int16_t peak);
+
+// Controller task
+void powerOnAlert();
+
+// Controller task, every tick: busy is true while an alert, recording or
+// transfer is in progress. Applies transitions and accumulates energy.
+void powerPoll(bool busy);
+
+PowerState powerState();
+
+// 0..100, or 255 without POWER_BATTERY_ADC_PIN
+uint8_t powerBatteryPercent();
+PowerReport powerReport();
+void powerPrintReport(Print &out);
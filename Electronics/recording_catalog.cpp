@@ -0,0 +1,383 @@
+#include "recording_catalog.h"
+#include "FS.h"
+#include "alert_frame.h"
+#include "sd_storage.h"
+#include "freertos/semphr.h"
+
+// On-card layout, read and written in place (little-endian like the ESP32)
+struct __attribute__((packed)) CatalogRecord {
+    uint32_t id;
+    uint32_t utc;
+    int32_t lat_e7;
+    int32_t lng_e7;
+    uint32_t sizeBytes;
+    uint32_t durationMs;
+    uint8_t codec;
+    uint8_t flags;
+    uint8_t reserved[4];
+    uint16_t crc;
+};
+
+struct __attribute__((packed)) CatalogHeader {
+    uint32_t magic;
+    uint16_t recordSize;
+    uint16_t reserved;
+    uint32_t nextId;
+    uint8_t zero[18];
+    uint16_t crc;
+};
+
+static_assert(sizeof(CatalogRecord) == CATALOG_RECORD_SIZE, "catalog record is 32 bytes");
+static_assert(sizeof(CatalogHeader) == CATALOG_RECORD_SIZE, "catalog header is one record");
+
+struct CatalogEntry {
+    CatalogClip clip;
+    uint16_t slot;                    // Record position in the index file
+};
+
+// Finished clips in id order, as a ring: pruning takes the oldest from the
+// head, new clips go on the tail
+static CatalogEntry *entries = nullptr;
+static size_t head = 0;
+static size_t count = 0;
+
+static CatalogEntry openEntry;        // Created, not yet finished
+static bool haveOpen = false;
+
+static SemaphoreHandle_t lock = NULL;
+static bool useSd = false;
+static uint32_t nextId = 1;
+static uint32_t pendingFrom = 0;      // No un-uploaded clip has an id below this
+static uint16_t fileSlots = 0;
+static uint16_t deletedSlots = 0;
+static CatalogStats stats = {};
+
+static CatalogEntry &at(size_t i) {
+    return entries[(head + i) % CATALOG_MAX_CLIPS];
+}
+
+static void encodeRecord(CatalogRecord &rec, const CatalogClip &clip) {
+    memset(&rec, 0, sizeof(rec));
+    rec.id = clip.id;
+    rec.utc = clip.utc;
+    rec.lat_e7 = clip.lat_e7;
+    rec.lng_e7 = clip.lng_e7;
+    rec.sizeBytes = clip.sizeBytes;
+    rec.durationMs = clip.durationMs;
+    rec.codec = clip.codec;
+    rec.flags = clip.flags;
+    rec.crc = frameCrc16((const uint8_t *)&rec, sizeof(rec) - 2);
+}
+
+static void decodeRecord(const CatalogRecord &rec, CatalogClip &clip) {
+    clip.id = rec.id;
+    clip.utc = rec.utc;
+    clip.lat_e7 = rec.lat_e7;
+    clip.lng_e7 = rec.lng_e7;
+    clip.sizeBytes = rec.sizeBytes;
+    clip.durationMs = rec.durationMs;
+    clip.codec = rec.codec;
+    clip.flags = rec.flags;
+}
+
+static void encodeHeader(CatalogHeader &header) {
+    memset(&header, 0, sizeof(header));
+    header.magic = CATALOG_MAGIC;
+    header.recordSize = CATALOG_RECORD_SIZE;
+    header.nextId = nextId;
+    header.crc = frameCrc16((const uint8_t *)&header, sizeof(header) - 2);
+}
+
+// One record, one sector: open, seek, write, close
+static bool writeSlot(uint16_t slot, const CatalogClip &clip) {
+    if (!useSd) return true;
+
+    CatalogRecord rec;
+    encodeRecord(rec, clip);
+    File f = sdStorage().open(CATALOG_PATH, "r+");
+    if (!f) return false;
+    bool ok = f.seek(CATALOG_RECORD_SIZE * (1 + (uint32_t)slot)) &&
+              f.write((const uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+    f.close();
+    return ok;
+}
+
+// Rewrite the index as a header plus the live clips, renumbering slots
+static bool compact() {
+    if (!useSd) return true;
+
+    File f = sdStorage().open(CATALOG_TMP_PATH, FILE_WRITE);
+    if (!f) return false;
+    CatalogHeader header;
+    encodeHeader(header);
+    bool ok = f.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+    for (size_t i = 0; i < count && ok; i++) {
+        CatalogRecord rec;
+        encodeRecord(rec, at(i).clip);
+        ok = f.write((const uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+    }
+    f.close();
+    if (!ok) {
+        sdStorage().remove(CATALOG_TMP_PATH);
+        return false;
+    }
+    sdStorage().remove(CATALOG_PATH);
+    sdStorage().rename(CATALOG_TMP_PATH, CATALOG_PATH);
+
+    for (size_t i = 0; i < count; i++) at(i).slot = (uint16_t)i;
+    fileSlots = (uint16_t)count;
+    deletedSlots = 0;
+    return true;
+}
+
+static void removeFile(uint32_t id) {
+    if (!useSd) return;
+    char path[CATALOG_CLIP_PATH_MAX];
+    catalogClipPath(id, path, sizeof(path));
+    sdStorage().remove(path);
+}
+
+static void deleteClip(CatalogEntry &entry) {
+    removeFile(entry.clip.id);
+    entry.clip.flags |= CATALOG_FLAG_DELETED;
+    writeSlot(entry.slot, entry.clip);
+    deletedSlots++;
+}
+
+// markSlot is false while loading: the compaction that follows drops it
+static void pruneOldest(bool markSlot = true) {
+    CatalogEntry &oldest = at(0);
+    stats.bytes -= oldest.clip.sizeBytes;
+    if (markSlot) {
+        deleteClip(oldest);
+    } else {
+        removeFile(oldest.clip.id);
+    }
+    head = (head + 1) % CATALOG_MAX_CLIPS;
+    count--;
+    stats.pruned++;
+}
+
+static bool needsRoom(uint32_t expectedBytes) {
+    if (count >= CATALOG_MAX_CLIPS) return true;
+    if ((uint64_t)stats.bytes + expectedBytes > CATALOG_QUOTA_BYTES) return true;
+    return useSd && sdStorageFreeBytes() < (uint64_t)expectedBytes + CATALOG_MIN_FREE_BYTES;
+}
+
+// Lowest index whose id is >= id (count if none)
+static size_t lowerBound(uint32_t id) {
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (at(mid).clip.id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static CatalogEntry *find(uint32_t id) {
+    size_t i = lowerBound(id);
+    return i < count && at(i).clip.id == id ? &at(i) : nullptr;
+}
+
+static void appendEntry(const CatalogEntry &entry, bool loading = false) {
+    if (count == CATALOG_MAX_CLIPS) pruneOldest(!loading);
+    at(count++) = entry;
+    stats.bytes += entry.clip.sizeBytes;
+}
+
+static void loadIndex() {
+    // A compaction interrupted between remove and rename
+    if (!sdStorage().exists(CATALOG_PATH) && sdStorage().exists(CATALOG_TMP_PATH)) {
+        sdStorage().rename(CATALOG_TMP_PATH, CATALOG_PATH);
+    }
+
+    File f = sdStorage().open(CATALOG_PATH, FILE_READ);
+    if (!f) return;
+
+    CatalogHeader header;
+    if (f.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.magic == CATALOG_MAGIC &&
+        header.recordSize == CATALOG_RECORD_SIZE &&
+        header.crc == frameCrc16((const uint8_t *)&header, sizeof(header) - 2)) {
+        nextId = header.nextId;
+    } else {
+        stats.badRecords++;
+    }
+
+    CatalogRecord rec;
+    uint16_t slot = 0;
+    uint32_t unfinished = 0;
+    while (f.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec)) {
+        uint16_t s = slot++;
+        if (rec.crc != frameCrc16((const uint8_t *)&rec, sizeof(rec) - 2)) {
+            stats.badRecords++;
+            continue;
+        }
+        if (rec.id >= nextId) nextId = rec.id + 1;
+        if (rec.flags & CATALOG_FLAG_DELETED) continue;
+
+        CatalogEntry entry;
+        decodeRecord(rec, entry.clip);
+        entry.slot = s;
+        if (entry.clip.sizeBytes == 0) {
+            // Still recording at reset, so its header was never patched.
+            // One clip records at a time; the compaction drops the record.
+            unfinished = entry.clip.id;
+            continue;
+        }
+        if (count > 0 && entry.clip.id <= at(count - 1).clip.id) {
+            stats.badRecords++;       // Out of order; ids only ever increase
+            continue;
+        }
+        appendEntry(entry, true);
+    }
+    f.close();
+    if (unfinished != 0) removeFile(unfinished);
+}
+
+bool catalogBegin(bool sdReady) {
+    if (entries == nullptr) {
+        entries = (CatalogEntry *)ps_malloc(CATALOG_MAX_CLIPS * sizeof(CatalogEntry));
+        if (entries == nullptr) {
+            entries = (CatalogEntry *)malloc(CATALOG_MAX_CLIPS * sizeof(CatalogEntry));
+        }
+        if (entries == nullptr) return false;
+        lock = xSemaphoreCreateMutex();
+        if (lock == NULL) return false;
+    }
+
+    useSd = sdReady;
+    if (useSd) {
+        loadIndex();
+        // Start every boot from a clean file: no deleted or unfinished slots
+        compact();
+    }
+    stats.clips = (uint16_t)count;
+    return true;
+}
+
+uint32_t catalogCreate(const CatalogClip &meta, uint32_t expectedBytes, char *path, size_t pathSize) {
+    if (entries == nullptr) return 0;
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    while (count > 0 && needsRoom(expectedBytes)) pruneOldest();
+    if (deletedSlots >= CATALOG_COMPACT_SLOTS) compact();
+
+    openEntry.clip = meta;
+    openEntry.clip.id = nextId++;
+    openEntry.clip.sizeBytes = 0;
+    openEntry.clip.flags &= CATALOG_FLAG_FIX;
+    openEntry.slot = fileSlots;
+    bool ok = writeSlot(openEntry.slot, openEntry.clip);
+    if (ok) {
+        fileSlots++;
+        haveOpen = true;
+        catalogClipPath(openEntry.clip.id, path, pathSize);
+    }
+    stats.clips = (uint16_t)count;
+    uint32_t id = ok ? openEntry.clip.id : 0;
+
+    xSemaphoreGive(lock);
+    return id;
+}
+
+bool catalogFinish(uint32_t id, uint32_t sizeBytes, uint32_t durationMs) {
+    if (entries == nullptr) return false;
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    bool ok = haveOpen && openEntry.clip.id == id;
+    if (ok) {
+        openEntry.clip.sizeBytes = sizeBytes;
+        openEntry.clip.durationMs = durationMs;
+        ok = writeSlot(openEntry.slot, openEntry.clip);
+        appendEntry(openEntry);
+        haveOpen = false;
+        stats.clips = (uint16_t)count;
+    }
+
+    xSemaphoreGive(lock);
+    return ok;
+}
+
+void catalogCancel(uint32_t id) {
+    if (entries == nullptr) return;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (haveOpen && openEntry.clip.id == id) {
+        deleteClip(openEntry);
+        haveOpen = false;
+    }
+    xSemaphoreGive(lock);
+}
+
+bool catalogMarkUploaded(uint32_t id) {
+    if (entries == nullptr) return false;
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    CatalogEntry *entry = find(id);
+    bool ok = entry != nullptr;
+    if (ok && !(entry->clip.flags & CATALOG_FLAG_UPLOADED)) {
+        entry->clip.flags |= CATALOG_FLAG_UPLOADED;
+        ok = writeSlot(entry->slot, entry->clip);
+    }
+
+    xSemaphoreGive(lock);
+    return ok;
+}
+
+size_t catalogCount() {
+    return count;
+}
+
+bool catalogAt(size_t index, CatalogClip &clip) {
+    if (entries == nullptr) return false;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    bool ok = index < count;
+    if (ok) clip = at(index).clip;
+    xSemaphoreGive(lock);
+    return ok;
+}
+
+bool catalogFind(uint32_t id, CatalogClip &clip) {
+    if (entries == nullptr) return false;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    CatalogEntry *entry = find(id);
+    if (entry != nullptr) clip = entry->clip;
+    xSemaphoreGive(lock);
+    return entry != nullptr;
+}
+
+bool catalogNextPending(CatalogClip &clip) {
+    if (entries == nullptr) return false;
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    // Uploads go oldest first, so the scan resumes where the last one ended
+    size_t i = lowerBound(pendingFrom);
+    while (i < count && (at(i).clip.flags & CATALOG_FLAG_UPLOADED)) i++;
+    bool found = i < count;
+    if (found) clip = at(i).clip;
+    pendingFrom = found ? at(i).clip.id : nextId;
+
+    xSemaphoreGive(lock);
+    return found;
+}
+
+void catalogClipPath(uint32_t id, char *path, size_t pathSize) {
+    snprintf(path, pathSize, CATALOG_CLIP_FORMAT, (unsigned long)id);
+}
+
+bool catalogIdFromPath(const char *path, uint32_t &id) {
+    unsigned long value;
+    int consumed = 0;
+    if (sscanf(path, CATALOG_CLIP_SCAN, &value, &consumed) != 1 || consumed == 0 || path[consumed] != '\0') {
+        return false;
+    }
+    id = (uint32_t)value;
+    return true;
+}
+
+CatalogStats catalogStats() {
+    return stats;
+}
@@ -0,0 +1,95 @@
+// Persistent catalog of recorded clips: ids, metadata and upload state
+#pragma once
+
+#include <Arduino.h>
+
+// Clips are named from their id, which keeps counting across resets:
+// /triggered_000042.wav
+#define CATALOG_CLIP_FORMAT       "/triggered_%06lu.wav"
+#define CATALOG_CLIP_SCAN         "/triggered_%lu.wav%n"
+#define CATALOG_CLIP_PATH_MAX     32
+
+// Index file: a CATALOG_RECORD_SIZE header, then one fixed-size record
+// per clip in id order. Records are 32 bytes and start 32 bytes in, so no
+// record straddles a 512-byte sector and every update is a single sector
+// write; each carries its own CRC, so a torn write costs at most that
+// record. A record is appended when the clip is opened and rewritten in
+// place when it is finished, uploaded or deleted. Once deleted slots pass
+// CATALOG_COMPACT_SLOTS the file is rewritten with the live records
+// (CATALOG_TMP_PATH, then rename).
+//
+//   Header                            Record
+//   0  u32  CATALOG_MAGIC             0  u32  id
+//   4  u16  CATALOG_RECORD_SIZE       4  u32  UTC start, 0 = clock not set
+//   6  u16  reserved                  8  i32  lat * 1e7 \ valid with
+//   8  u32  next id                  12  i32  lng * 1e7 / CATALOG_FLAG_FIX
+//  12  ...  zero                     16  u32  file size in bytes, 0 = open
+//  30  u16  CRC                      20  u32  duration in ms
+//                                    24  u8   RecorderCodec
+//                                    25  u8   CATALOG_FLAG_*
+//                                    26  u8   reserved x4
+//                                    30  u16  CRC-16/CCITT-FALSE of 0..29
+#define CATALOG_PATH              "/recordings.idx"
+#define CATALOG_TMP_PATH          "/recordings.tmp"
+#define CATALOG_MAGIC             0x31584449u     // "IDX1"
+#define CATALOG_RECORD_SIZE       32
+#define CATALOG_COMPACT_SLOTS     64
+
+#define CATALOG_FLAG_FIX          0x01
+#define CATALOG_FLAG_UPLOADED     0x02            // Transferred to the app in full
+#define CATALOG_FLAG_DELETED      0x04
+
+// Clips held in RAM for lookups (32 bytes each, PSRAM when available).
+// Past this, and whenever a new clip would take recordings over the quota
+// or leave the card under CATALOG_MIN_FREE_BYTES, the oldest clips are
+// deleted first.
+#define CATALOG_MAX_CLIPS         1024
+#define CATALOG_QUOTA_BYTES       (256UL * 1024 * 1024)
+#define CATALOG_MIN_FREE_BYTES    (16UL * 1024 * 1024)
+
+struct CatalogClip {
+    uint32_t id;
+    uint32_t utc;
+    int32_t lat_e7;
+    int32_t lng_e7;
+    uint32_t sizeBytes;
+    uint32_t durationMs;
+    uint8_t codec;
+    uint8_t flags;
+};
+
+struct CatalogStats {
+    uint16_t clips;
+    uint32_t bytes;                   // Total size of the finished clips
+    uint32_t pruned;                  // Deleted for space since boot
+    uint32_t badRecords;              // Torn or corrupt records skipped at begin
+};
+
+// Load the index (if sdReady), settle clips left open by a reset and
+// compact. All other calls are safe from any task.
+bool catalogBegin(bool sdReady);
+
+// Make room for expectedBytes, then add a clip with the next id. Fills
+// path with its file name; returns the id, 0 on failure.
+uint32_t catalogCreate(const CatalogClip &meta, uint32_t expectedBytes, char *path, size_t pathSize);
+
+// The clip's file has been closed
+bool catalogFinish(uint32_t id, uint32_t sizeBytes, uint32_t durationMs);
+
+// The recording never started: drop the clip and its file
+void catalogCancel(uint32_t id);
+
+bool catalogMarkUploaded(uint32_t id);
+
+// Finished clips, oldest first: index lookups are O(1), by id O(log n)
+size_t catalogCount();
+bool catalogAt(size_t index, CatalogClip &clip);
+bool catalogFind(uint32_t id, CatalogClip &clip);
+
+// Oldest finished clip not yet uploaded
+bool catalogNextPending(CatalogClip &clip);
+
+void catalogClipPath(uint32_t id, char *path, size_t pathSize);
+bool catalogIdFromPath(const char *path, uint32_t &id);
+
+CatalogStats catalogStats();
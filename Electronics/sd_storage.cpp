@@ -0,0 +1,121 @@
+#include "sd_storage.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include "esp_timer.h"
+#include "trace.h"
+#if SD_STORAGE_SDMMC
+#include "SD_MMC.h"
+#define SD_CARD SD_MMC
+#else
+#include "SD.h"
+#include "SPI.h"
+#define SD_CARD SD
+#endif
+
+#define SD_PATH_MAX 80
+
+static bool ready = false;
+static SdStorageStats stats = {};
+
+// Internal RAM, word aligned: the SPI and SDMMC hosts DMA straight from it
+DMA_ATTR static uint8_t block[SD_WRITE_BLOCK];
+static size_t blockFill = 0;
+static int fd = -1;
+static uint32_t written = 0;          // Bytes handed to write() so far
+static char posixPath[SD_PATH_MAX];
+
+bool sdStorageBegin() {
+#if SD_STORAGE_SDMMC
+    SD_MMC.setPins(SD_MMC_PIN_CLK, SD_MMC_PIN_CMD, SD_MMC_PIN_D0,
+                   SD_MMC_PIN_D1, SD_MMC_PIN_D2, SD_MMC_PIN_D3);
+    ready = SD_MMC.begin(SD_MOUNT_POINT, false, false, SDMMC_FREQ_HIGHSPEED);
+#else
+    ready = SD.begin(SD_SPI_CS, SPI, SD_SPI_FREQ_HZ, SD_MOUNT_POINT);
+#endif
+    return ready;
+}
+
+bool sdStorageReady() {
+    return ready;
+}
+
+fs::FS &sdStorage() {
+    return SD_CARD;
+}
+
+uint64_t sdStorageFreeBytes() {
+    return ready ? SD_CARD.totalBytes() - SD_CARD.usedBytes() : 0;
+}
+
+bool sdRecordingOpen(const char *path, uint32_t expectedBytes) {
+    if (!ready || fd >= 0) return false;
+
+    // Whole blocks, so the last data block is allocated too
+    uint32_t prealloc = (expectedBytes + SD_WRITE_BLOCK - 1) / SD_WRITE_BLOCK * SD_WRITE_BLOCK;
+
+    snprintf(posixPath, sizeof(posixPath), SD_MOUNT_POINT "%s", path);
+    fd = open(posixPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    // Seeking past the end and writing a byte makes FatFs chain every
+    // cluster now, from the first free one on, instead of one per cluster
+    // boundary while the clip streams in
+    bool allocated = prealloc > 0 && lseek(fd, prealloc - 1, SEEK_SET) == (off_t)(prealloc - 1) &&
+                     write(fd, "", 1) == 1;
+    if (!allocated) stats.preallocFailures++;
+    lseek(fd, 0, SEEK_SET);
+
+    blockFill = 0;
+    written = 0;
+    stats.lastMaxWriteUs = 0;
+    return true;
+}
+
+static bool writeBlock(size_t len) {
+    TRACE(TRACE_SD_WRITE_START, len);
+    int64_t start = esp_timer_get_time();
+    bool ok = write(fd, block, len) == (ssize_t)len;
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+    TRACE(TRACE_SD_WRITE_END, ok ? len : 0);
+
+    stats.writes++;
+    if (us > stats.lastMaxWriteUs) stats.lastMaxWriteUs = us;
+    if (us > stats.maxWriteUs) stats.maxWriteUs = us;
+    if (ok) written += len;
+    blockFill = 0;
+    return ok;
+}
+
+bool sdRecordingWrite(const uint8_t *data, size_t len) {
+    if (fd < 0) return false;
+    bool ok = true;
+    while (len > 0) {
+        size_t n = SD_WRITE_BLOCK - blockFill;
+        if (n > len) n = len;
+        memcpy(&block[blockFill], data, n);
+        blockFill += n;
+        data += n;
+        len -= n;
+        if (blockFill == SD_WRITE_BLOCK && !writeBlock(SD_WRITE_BLOCK)) ok = false;
+    }
+    return ok;
+}
+
+bool sdRecordingFinish(const uint8_t *header, size_t headerLen) {
+    if (fd < 0) return false;
+
+    bool ok = blockFill == 0 || writeBlock(blockFill);
+    uint32_t size = written;
+    if (lseek(fd, 0, SEEK_SET) != 0 || write(fd, header, headerLen) != (ssize_t)headerLen) ok = false;
+    close(fd);
+    fd = -1;
+
+    // Give back the preallocated clusters past the end of the clip
+    if (truncate(posixPath, size) != 0) ok = false;
+    stats.lastFileBytes = size;
+    return ok;
+}
+
+SdStorageStats sdStorageStats() {
+    return stats;
+}
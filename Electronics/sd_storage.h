@@ -0,0 +1,59 @@
+// SD card storage: mount and the recorder's write path
+#pragma once
+
+#include <Arduino.h>
+#include "FS.h"
+
+// Bus: SPI by default (the XIAO ESP32-S3 Sense expansion board wires only
+// CS/SCK/MISO/MOSI). Boards that route all four data lines can build with
+// -DSD_STORAGE_SDMMC=1 for the SDMMC host in 4-bit mode.
+#ifndef SD_STORAGE_SDMMC
+#define SD_STORAGE_SDMMC 0
+#endif
+
+#define SD_SPI_CS          21
+#define SD_SPI_FREQ_HZ     20000000
+
+#define SD_MMC_PIN_CLK     7
+#define SD_MMC_PIN_CMD     9
+#define SD_MMC_PIN_D0      8
+#define SD_MMC_PIN_D1      10
+#define SD_MMC_PIN_D2      11
+#define SD_MMC_PIN_D3      12
+
+// Both buses mount here; POSIX calls take SD_MOUNT_POINT + path
+#define SD_MOUNT_POINT     "/sd"
+
+// Recorder writes leave the buffer in whole SD_WRITE_BLOCK units at
+// SD_WRITE_BLOCK-aligned file offsets, so FatFs hands them to the card as
+// multi-sector transfers without staging them in its sector window. Only
+// the final write of a clip is partial.
+#define SD_SECTOR_BYTES    512
+#define SD_WRITE_BLOCK     (16 * SD_SECTOR_BYTES)
+
+struct SdStorageStats {
+    uint32_t lastFileBytes;           // Size of the last clip finished
+    uint32_t writes;                  // Block writes since boot
+    uint32_t lastMaxWriteUs;          // Slowest block write of the last clip
+    uint32_t maxWriteUs;              // ... and since boot
+    uint32_t preallocFailures;        // Clips written without preallocation
+};
+
+// Mount the card on the configured bus. False when there is no card.
+bool sdStorageBegin();
+bool sdStorageReady();
+
+// The mounted filesystem, for everything that reads or writes SD
+fs::FS &sdStorage();
+uint64_t sdStorageFreeBytes();
+
+// One clip at a time (the recorder). Create path and preallocate
+// expectedBytes of clusters for it; the recording catalog has already
+// made room. The clip then goes through
+// sdRecordingWrite(); sdRecordingFinish() flushes the tail, rewrites the
+// first headerLen bytes with header and trims the file to what was written.
+bool sdRecordingOpen(const char *path, uint32_t expectedBytes);
+bool sdRecordingWrite(const uint8_t *data, size_t len);
+bool sdRecordingFinish(const uint8_t *header, size_t headerLen);
+
+SdStorageStats sdStorageStats();
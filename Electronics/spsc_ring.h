@@ -0,0 +1,68 @@
+// Lock-free single-producer / single-consumer ring of fixed-size slots
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Slots are written and read in place, so a frame is never copied between
+// the producer task and the consumer. N must be a power of two; the head and
+// tail counters run freely and are masked on access.
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    // Producer side: slot to fill, or nullptr when the ring is full
+    T *writeSlot() {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= N) {
+            return nullptr;
+        }
+        return &slots[h & (N - 1)];
+    }
+
+    void commitWrite() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool push(const T &item) {
+        T *slot = writeSlot();
+        if (slot == nullptr) return false;
+        *slot = item;
+        commitWrite();
+        return true;
+    }
+
+    // Consumer side: oldest filled slot, or nullptr when the ring is empty
+    const T *readSlot() {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots[t & (N - 1)];
+    }
+
+    void releaseRead() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool pop(T &item) {
+        const T *slot = readSlot();
+        if (slot == nullptr) return false;
+        item = *slot;
+        releaseRead();
+        return true;
+    }
+
+    size_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    T slots[N];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+};
@@ -0,0 +1,30 @@
+#include "state_machine.h"
+#include "trace.h"
+
+void smStart(StateMachine &sm, uint8_t initial) {
+    sm.state = initial;
+    sm.transitions = 0;
+    sm.ignored = 0;
+    if (sm.onEnter != nullptr) sm.onEnter(initial);
+}
+
+bool smDispatch(StateMachine &sm, const AppEvent &event) {
+    for (size_t i = 0; i < sm.rows; i++) {
+        const SmTransition &row = sm.table[i];
+        if (row.event != event.type || (row.state != SM_ANY && row.state != sm.state)) continue;
+        if (row.guard != nullptr && !row.guard(event)) continue;
+
+        uint8_t from = sm.state;
+        uint8_t to = row.next == SM_STAY ? from : row.next;
+        TRACE(TRACE_STATE, from | to << 4 | event.type << 8);
+        if (row.action != nullptr) row.action(event);
+        if (row.next != SM_STAY) {
+            sm.state = to;
+            sm.transitions++;
+            if (sm.onEnter != nullptr) sm.onEnter(to);
+        }
+        return true;
+    }
+    sm.ignored++;
+    return false;
+}
@@ -0,0 +1,37 @@
+// Table-driven controller state machine over the app event queue
+#pragma once
+
+#include <Arduino.h>
+#include "app_tasks.h"
+
+// A transition table is scanned in order for the first row whose state and
+// event match and whose guard (if any) passes. Its action runs, then the
+// machine moves to the row's target and that state's onEnter runs; a row
+// that targets its own state re-enters it (timers restart). SM_STAY rows
+// run the action and leave the state alone. Events no row takes are
+// counted and dropped. Every taken row is traced as TRACE_STATE.
+#define SM_ANY   0xFE                 // Row state: matches in every state
+#define SM_STAY  0xFF                 // Row target: action only
+
+struct SmTransition {
+    uint8_t state;
+    AppEventType event;
+    uint8_t next;
+    bool (*guard)(const AppEvent &event);
+    void (*action)(const AppEvent &event);
+};
+
+struct StateMachine {
+    const SmTransition *table;
+    size_t rows;
+    void (*onEnter)(uint8_t state);
+    uint8_t state;
+    uint32_t transitions;
+    uint32_t ignored;                 // Events no row accepted
+};
+
+// Enter initial (onEnter runs) without consulting the table
+void smStart(StateMachine &sm, uint8_t initial);
+
+// Owner task only. True if a row took the event.
+bool smDispatch(StateMachine &sm, const AppEvent &event);
@@ -0,0 +1,64 @@
+#include "status_report.h"
+#include "ble_tx_queue.h"
+
+static StatusFrame reported = {};     // Values as of the last frame sent
+static uint8_t dirty = 0;             // Fields changed since the last full frame
+static bool wasConnected = false;
+static uint32_t lastFullMs = 0;
+static uint32_t lastSentMs = 0;
+static uint32_t framesSent = 0;
+
+static uint8_t changedFields(const StatusFrame &now) {
+    uint8_t mask = 0;
+    if (now.mode != reported.mode) mask |= STATUS_FIELD_MODE;
+    if (now.batteryPct != reported.batteryPct) mask |= STATUS_FIELD_BATTERY;
+    // Satellite count alone wanders too much to be worth a notify
+    if (now.gpsFlags != reported.gpsFlags) mask |= STATUS_FIELD_GPS;
+    if (abs(now.noiseFloorDb - reported.noiseFloorDb) >= STATUS_NOISE_STEP_DB) mask |= STATUS_FIELD_NOISE;
+    if (now.alertsPending != reported.alertsPending) mask |= STATUS_FIELD_ALERTS;
+    return mask;
+}
+
+static void send(const StatusFrame &now, uint8_t mask, uint32_t nowMs) {
+    uint8_t frame[STATUS_FRAME_MAX_SIZE];
+    size_t len = statusFrameEncode(now, mask, frame);
+    bleTxEnqueue(BLE_TX_STATUS, frame, len);
+
+    // Only what was sent becomes the reference; a sub-step noise drift
+    // keeps accumulating against the old value
+    if (mask & STATUS_FIELD_MODE) reported.mode = now.mode;
+    if (mask & STATUS_FIELD_BATTERY) reported.batteryPct = now.batteryPct;
+    if (mask & STATUS_FIELD_GPS) {
+        reported.gpsFlags = now.gpsFlags;
+        reported.sats = now.sats;
+    }
+    if (mask & STATUS_FIELD_NOISE) reported.noiseFloorDb = now.noiseFloorDb;
+    if (mask & STATUS_FIELD_ALERTS) reported.alertsPending = now.alertsPending;
+    lastSentMs = nowMs;
+    framesSent++;
+}
+
+void statusReportPoll(const StatusFrame &current, bool connected, uint32_t keepaliveMs) {
+    if (!connected) {
+        wasConnected = false;
+        return;
+    }
+
+    uint32_t now = millis();
+    if (!wasConnected || now - lastFullMs >= keepaliveMs) {
+        wasConnected = true;
+        dirty = 0;
+        lastFullMs = now;
+        send(current, STATUS_FIELD_ALL, now);
+        return;
+    }
+
+    uint8_t changed = changedFields(current);
+    if (changed == 0 || now - lastSentMs < STATUS_MIN_INTERVAL_MS) return;
+    dirty |= changed;
+    send(current, dirty, now);
+}
+
+uint32_t statusReportFramesSent() {
+    return framesSent;
+}
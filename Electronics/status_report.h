@@ -0,0 +1,21 @@
+// Event-driven, delta-encoded status notifications
+#pragma once
+
+#include <Arduino.h>
+#include "alert_frame.h"
+
+// A status frame goes out when a field changes, at most every
+// STATUS_MIN_INTERVAL_MS, and a full one every keepalive interval or on
+// connect. The noise floor only counts as changed once it has moved
+// STATUS_NOISE_STEP_DB from the value last reported.
+#define STATUS_MIN_INTERVAL_MS 1000
+#define STATUS_NOISE_STEP_DB   3
+
+// Controller task, every pass. Deltas carry every field that has changed
+// since the last full frame, not just since the last delta: status
+// notifies are coalesced in the TX queue, so an overwritten delta must not
+// lose a field.
+void statusReportPoll(const StatusFrame &current, bool connected, uint32_t keepaliveMs);
+
+// Status frames queued, full and delta
+uint32_t statusReportFramesSent();
@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+"""Latency histograms from the firmware trace (Electronics/trace.h).
+
+Reads a binary dump either from a file or straight from the serial console
+(sends TRACE_SERIAL_DUMP_CHAR and picks the dump out of the log text), pairs
+trace events into spans along the alert path and prints a histogram and
+percentiles per span.
+
+    trace_histogram.py --port /dev/ttyACM0
+    trace_histogram.py dump.bin
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+DUMP_MAGIC = 0x31435254  # "TRC1"
+DUMP_CHAR = b"T"
+HEADER = struct.Struct("<IIH")
+RECORD = struct.Struct("<IHBB")
+
+EVENTS = [
+    "none", "pin_isr", "frame_read", "frame_analyzed", "detection",
+    "alert_send", "notify_queued", "notify_sent", "sd_write_start",
+    "sd_write_end", "state", "trigger",
+]
+EVENT = {name: i for i, name in enumerate(EVENTS)}
+TX_ALERT = 0  # BleTxPriority
+
+# Span name, start event, end event, end filter. The end is the first
+# matching event after the start; same_core pairs only on one core.
+SPANS = [
+    ("pin isr -> notify sent", "pin_isr", "notify_sent", lambda r: r["arg"] == TX_ALERT, False),
+    ("pin isr -> alert send", "pin_isr", "alert_send", None, False),
+    ("frame read -> analyzed", "frame_read", "frame_analyzed", None, True),
+    ("detection -> alert send", "detection", "alert_send", None, False),
+    ("trigger -> alert send", "trigger", "alert_send", None, False),
+    ("alert send -> queued", "alert_send", "notify_queued", lambda r: r["arg"] == TX_ALERT, False),
+    ("alert queued -> sent", "notify_queued", "notify_sent", lambda r: r["arg"] == TX_ALERT, False),
+    ("sd write", "sd_write_start", "sd_write_end", None, True),
+]
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, as frameCrc16() on the device."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def parse_dump(data):
+    """Find and decode the first complete dump in data; list of records."""
+    magic = struct.pack("<I", DUMP_MAGIC)
+    start = data.find(magic)
+    while start >= 0:
+        if len(data) - start >= HEADER.size:
+            _, written, count = HEADER.unpack_from(data, start)
+            end = start + HEADER.size + count * RECORD.size
+            if len(data) >= end + 2:
+                (crc,) = struct.unpack_from("<H", data, end)
+                if crc16(data[start:end]) == crc:
+                    return written, decode_records(data[start + HEADER.size:end])
+        start = data.find(magic, start + 1)
+    return None
+
+
+def decode_records(body):
+    records = []
+    for time_us, arg, event, core in RECORD.iter_unpack(body):
+        if event == EVENT["none"] or event >= len(EVENTS):
+            continue
+        records.append({"t": time_us, "arg": arg, "event": EVENTS[event], "core": core})
+    return records
+
+
+def read_serial(port, baud, timeout):
+    import serial  # pyserial, only needed for live capture
+
+    with serial.Serial(port, baud, timeout=0.2) as link:
+        link.reset_input_buffer()
+        link.write(DUMP_CHAR)
+        data = b""
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            data += link.read(4096)
+            dump = parse_dump(data)
+            if dump is not None:
+                return dump
+    return None
+
+
+def spans(records):
+    """Durations in microseconds for each span in SPANS."""
+    result = {name: [] for name, *_ in SPANS}
+    for name, start, end, accept, same_core in SPANS:
+        for i, rec in enumerate(records):
+            if rec["event"] != start:
+                continue
+            for later in records[i + 1:]:
+                if later["event"] == start and (not same_core or later["core"] == rec["core"]):
+                    break  # Next start came first: no end for this one
+                if later["event"] != end:
+                    continue
+                if same_core and later["core"] != rec["core"]:
+                    continue
+                if accept is not None and not accept(later):
+                    continue
+                # Timestamps are the low 32 bits of esp_timer and wrap
+                result[name].append((later["t"] - rec["t"]) & 0xFFFFFFFF)
+                break
+    return result
+
+
+def percentile(values, p):
+    ordered = sorted(values)
+    index = min(len(ordered) - 1, int(round(p / 100.0 * (len(ordered) - 1))))
+    return ordered[index]
+
+
+def print_histogram(name, values, buckets, width=40):
+    print(f"{name}: {len(values)} samples")
+    if not values:
+        print()
+        return
+    print("  min {} us, p50 {} us, p90 {} us, p99 {} us, max {} us".format(
+        min(values), percentile(values, 50), percentile(values, 90),
+        percentile(values, 99), max(values)))
+
+    # Log-spaced buckets from the smallest to the largest sample
+    low = max(1, min(values))
+    high = max(values) + 1
+    ratio = (high / low) ** (1.0 / buckets) if high > low else 2.0
+    edges = [low * ratio ** i for i in range(buckets + 1)]
+    counts = [0] * buckets
+    for v in values:
+        for b in range(buckets):
+            if v < edges[b + 1] or b == buckets - 1:
+                counts[b] += 1
+                break
+    peak = max(counts)
+    for b, count in enumerate(counts):
+        if count == 0:
+            continue
+        bar = "#" * max(1, round(count * width / peak))
+        print(f"  {edges[b]:>10.0f} - {edges[b + 1]:<10.0f} us {count:>5} {bar}")
+    print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dump", nargs="?", help="binary dump file (default: read from --port)")
+    parser.add_argument("--port", help="serial console to request a dump from")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--timeout", type=float, default=5.0, help="seconds to wait for the dump")
+    parser.add_argument("--save", help="also write the raw dump here")
+    parser.add_argument("--buckets", type=int, default=12)
+    parser.add_argument("--events", action="store_true", help="list every record")
+    args = parser.parse_args()
+
+    if args.dump:
+        with open(args.dump, "rb") as f:
+            dump = parse_dump(f.read())
+    elif args.port:
+        dump = read_serial(args.port, args.baud, args.timeout)
+    else:
+        parser.error("give a dump file or --port")
+
+    if dump is None:
+        sys.exit("no valid trace dump found")
+    written, records = dump
+
+    if args.save:
+        with open(args.save, "wb") as f:
+            body = b"".join(RECORD.pack(r["t"], r["arg"], EVENT[r["event"]], r["core"]) for r in records)
+            head = HEADER.pack(DUMP_MAGIC, written, len(records)) + body
+            f.write(head + struct.pack("<H", crc16(head)))
+
+    print(f"{len(records)} records ({written} written since boot)\n")
+    if args.events:
+        for r in records:
+            arg = r["arg"]
+            if r["event"] == "state":
+                arg = f"{arg & 0xF} -> {(arg >> 4) & 0xF} on event {arg >> 8}"
+            elif r["event"] == "trigger":
+                arg = f"source {arg & 0xFF} score {arg >> 8}"
+            print(f"  {r['t']:>10} core {r['core']} {r['event']:<15} {arg}")
+        print()
+    for name, values in spans(records).items():
+        print_histogram(name, values, args.buckets)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,97 @@
+#include "trace.h"
+#include <atomic>
+#include "alert_frame.h"
+#include "esp_timer.h"
+
+static_assert((TRACE_DEPTH & (TRACE_DEPTH - 1)) == 0, "TRACE_DEPTH must be a power of two");
+
+// seq is the record's index + 1 once it is complete and 0 while a writer
+// is filling it in; a reader that sees the same seq before and after its
+// copy has a whole record
+struct TraceSlot {
+    std::atomic<uint32_t> seq;
+    TraceRecord record;
+};
+
+static TraceSlot slots[TRACE_DEPTH];
+static std::atomic<uint32_t> head{0};
+static std::atomic<bool> frozen{false};
+static std::atomic<uint32_t> frozenAtUs{0};
+
+void IRAM_ATTR traceRecord(TraceEvent event, uint16_t arg) {
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    if (frozen.load(std::memory_order_relaxed)) {
+        if (now - frozenAtUs.load(std::memory_order_relaxed) < TRACE_FREEZE_MAX_US) return;
+        frozen.store(false, std::memory_order_relaxed);
+    }
+
+    uint32_t index = head.fetch_add(1, std::memory_order_relaxed);
+    TraceSlot &slot = slots[index & (TRACE_DEPTH - 1)];
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.record.timeUs = now;
+    slot.record.arg = arg;
+    slot.record.event = event;
+    slot.record.core = (uint8_t)xPortGetCoreID();
+    slot.seq.store(index + 1, std::memory_order_release);
+}
+
+void traceFreeze(bool freeze) {
+    frozenAtUs.store((uint32_t)esp_timer_get_time(), std::memory_order_relaxed);
+    frozen.store(freeze, std::memory_order_relaxed);
+}
+
+uint32_t traceWritten() {
+    return head.load(std::memory_order_relaxed);
+}
+
+size_t traceRead(uint16_t first, TraceRecord *out, size_t max, uint16_t *total) {
+    uint32_t end = head.load(std::memory_order_acquire);
+    uint32_t held = end < TRACE_DEPTH ? end : TRACE_DEPTH;
+    *total = (uint16_t)held;
+    if (first >= held) return 0;
+
+    uint32_t oldest = end - held;
+    size_t count = held - first < max ? held - first : max;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t index = oldest + first + i;
+        const TraceSlot &slot = slots[index & (TRACE_DEPTH - 1)];
+        uint32_t before = slot.seq.load(std::memory_order_acquire);
+        out[i] = slot.record;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (before != index + 1 || slot.seq.load(std::memory_order_relaxed) != before) {
+            out[i].event = TRACE_NONE;
+        }
+    }
+    return count;
+}
+
+static uint16_t dumpWrite(Print &out, uint16_t crc, const void *data, size_t len) {
+    out.write((const uint8_t *)data, len);
+    return frameCrc16Update(crc, (const uint8_t *)data, len);
+}
+
+void traceDump(Print &out) {
+    traceFreeze(true);
+
+    TraceRecord chunk[32];
+    uint16_t total = 0;
+    traceRead(0, chunk, 0, &total);
+
+    uint32_t magic = TRACE_DUMP_MAGIC;
+    uint32_t written = traceWritten();
+    uint16_t crc = FRAME_CRC_INIT;
+    crc = dumpWrite(out, crc, &magic, sizeof(magic));
+    crc = dumpWrite(out, crc, &written, sizeof(written));
+    crc = dumpWrite(out, crc, &total, sizeof(total));
+    for (uint16_t first = 0; first < total;) {
+        uint16_t held;
+        size_t n = traceRead(first, chunk, sizeof(chunk) / sizeof(chunk[0]), &held);
+        if (n == 0) break;
+        crc = dumpWrite(out, crc, chunk, n * sizeof(TraceRecord));
+        first += n;
+    }
+    out.write((const uint8_t *)&crc, sizeof(crc));
+
+    traceFreeze(false);
+}
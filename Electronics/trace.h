@@ -0,0 +1,76 @@
+// Flight-recorder trace of the alert pipeline: fixed-size timestamped
+// events in a lock-free ring, dumped in binary over serial or BLE and turned
+// into latency histograms by tools/trace_histogram.py
+#pragma once
+
+#include <Arduino.h>
+
+// 0 compiles every TRACE() point out
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE 1
+#endif
+
+#define TRACE_DEPTH          512      // Records, power of two; 4 KB of RAM
+#define TRACE_FREEZE_MAX_US  5000000  // A reader that stops paging can't stall the trace
+
+// Serial dump: send this byte on the console to get a binary dump. Console
+// lines are held off meanwhile (fixedLogHold()); CMD_GET_TRACE is the path
+// nothing else writes into.
+#define TRACE_SERIAL_DUMP_CHAR 'T'
+
+// Dump layout (little-endian), serial and host script:
+//   0  u32  TRACE_DUMP_MAGIC
+//   4  u32  records ever written (older ones have been overwritten)
+//   8  u16  record count n
+//  10  {TraceRecord} x n, oldest first; torn records have event TRACE_NONE
+//   .  u16  CRC-16/CCITT-FALSE over everything before it
+#define TRACE_DUMP_MAGIC 0x31435254u  // "TRC1"
+
+enum TraceEvent : uint8_t {
+    TRACE_NONE,
+    TRACE_PIN_ISR,                    // arg 0
+    TRACE_FRAME_READ,                 // I2S frame in; arg 1 when the ring was full
+    TRACE_FRAME_ANALYZED,             // arg score
+    TRACE_DETECTION,                  // Sustained voice trigger; arg score
+    TRACE_ALERT_SEND,                 // sendAlert() entry; arg AlertFrameType
+    TRACE_NOTIFY_QUEUED,              // bleTxEnqueue() accepted; arg BleTxPriority
+    TRACE_NOTIFY_SENT,                // Handed to the stack; arg BleTxPriority
+    TRACE_SD_WRITE_START,             // arg bytes
+    TRACE_SD_WRITE_END,               // arg bytes written
+    TRACE_STATE,                      // Controller transition; arg from | to << 4 | AppEventType << 8
+    TRACE_TRIGGER,                    // Detector event posted; arg TriggerSource | score << 8
+    TRACE_EVENT_COUNT
+};
+
+// Timestamps are esp_timer (systimer) microseconds rather than CCOUNT: the
+// path crosses both cores and each core's cycle counter runs on its own
+struct __attribute__((packed)) TraceRecord {
+    uint32_t timeUs;                  // Low 32 bits of esp_timer_get_time()
+    uint16_t arg;
+    uint8_t event;
+    uint8_t core;
+};
+
+static_assert(sizeof(TraceRecord) == 8, "TraceRecord is 8 bytes on the wire");
+
+// Safe from any task or ISR, on either core; never blocks
+void traceRecord(TraceEvent event, uint16_t arg);
+
+// Stop recording while a reader pages through the ring (cleared by
+// traceFreeze(false) or after TRACE_FREEZE_MAX_US)
+void traceFreeze(bool frozen);
+
+// Copy up to max records starting first records after the oldest one still
+// held. total gets the number held (at most TRACE_DEPTH).
+size_t traceRead(uint16_t first, TraceRecord *out, size_t max, uint16_t *total);
+
+uint32_t traceWritten();
+
+// Freeze, write the whole ring in the dump layout above, resume
+void traceDump(Print &out);
+
+#if TRACE_ENABLE
+#define TRACE(event, arg) traceRecord((event), (uint16_t)(arg))
+#else
+#define TRACE(event, arg) do {} while (0)
+#endif
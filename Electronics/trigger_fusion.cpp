@@ -0,0 +1,142 @@
+#include "trigger_fusion.h"
+#include "fixed_format.h"
+#include "trace.h"
+
+static QueueHandle_t appQueue = NULL;
+
+// Written by the source's begin() before it posts, read everywhere after
+static TriggerDetector detectors[TRIGGER_SRC_COUNT];
+static bool registered[TRIGGER_SRC_COUNT] = {};
+static volatile uint32_t cooldowns[TRIGGER_SRC_COUNT];
+
+// Producer side, one task or ISR per source
+static int64_t lastWeakPostUs[TRIGGER_SRC_COUNT] = {};
+
+// Controller task only
+struct SourceState {
+    int64_t lastAlertUs;              // Start of the cooldown, 0 = none yet
+    int64_t weakUs;                   // Latest weak event still in play, 0 = none
+    uint8_t weakScore;
+};
+static SourceState sources[TRIGGER_SRC_COUNT] = {};
+static TriggerStats stats[TRIGGER_SRC_COUNT] = {};
+
+void triggerBegin(QueueHandle_t eventQueue) {
+    appQueue = eventQueue;
+}
+
+void triggerRegister(TriggerSource source, const TriggerDetector &detector) {
+    if (source >= TRIGGER_SRC_COUNT) return;
+    detectors[source] = detector;
+    cooldowns[source] = detector.cooldownMs;
+    registered[source] = true;
+}
+
+void triggerSetCooldown(TriggerSource source, uint32_t cooldownMs) {
+    if (source < TRIGGER_SRC_COUNT) cooldowns[source] = cooldownMs;
+}
+
+bool triggerRegistered(TriggerSource source) {
+    return source < TRIGGER_SRC_COUNT && registered[source];
+}
+
+static bool weakPostAllowed(TriggerSource source, uint8_t score, int64_t timestampUs) {
+    if (score >= detectors[source].alertScore) return true;
+    if (lastWeakPostUs[source] != 0 && timestampUs - lastWeakPostUs[source] < TRIGGER_WEAK_INTERVAL_MS * 1000LL) {
+        stats[source].rateLimited++;
+        return false;
+    }
+    lastWeakPostUs[source] = timestampUs;
+    return true;
+}
+
+bool triggerPost(TriggerSource source, uint8_t score, int64_t timestampUs) {
+    if (appQueue == NULL || !triggerRegistered(source) || !weakPostAllowed(source, score, timestampUs)) {
+        return false;
+    }
+    TRACE(TRACE_TRIGGER, source | score << 8);
+    AppEvent event = {APP_EVT_TRIGGER, timestampUs, source, score};
+    return xQueueSend(appQueue, &event, 0) == pdTRUE;
+}
+
+bool IRAM_ATTR triggerPostFromISR(TriggerSource source, uint8_t score, int64_t timestampUs, BaseType_t *woken) {
+    if (appQueue == NULL || source >= TRIGGER_SRC_COUNT || !registered[source]) return false;
+    TRACE(TRACE_TRIGGER, source | score << 8);
+    AppEvent event = {APP_EVT_TRIGGER, timestampUs, source, score};
+    return xQueueSendToFrontFromISR(appQueue, &event, woken) == pdTRUE;
+}
+
+static void startCooldown(TriggerSource source, int64_t nowUs) {
+    sources[source].lastAlertUs = nowUs;
+    sources[source].weakUs = 0;
+}
+
+bool triggerFuse(const AppEvent &event, TriggerDecision &decision) {
+    TriggerSource source = (TriggerSource)event.source;
+    if (!triggerRegistered(source)) return false;
+    const TriggerDetector &detector = detectors[source];
+    SourceState &state = sources[source];
+    int64_t now = event.timestamp_us;
+    stats[source].events++;
+
+    if (state.lastAlertUs != 0 && now - state.lastAlertUs < (int64_t)cooldowns[source] * 1000) {
+        stats[source].cooledDown++;
+        return false;
+    }
+
+    decision.source = source;
+    decision.alertType = detector.alertType;
+    decision.score = event.score;
+    decision.sources = 1;
+    decision.record = detector.record;
+    decision.timestampUs = now;
+
+    if (event.score >= detector.alertScore) {
+        startCooldown(source, now);
+        stats[source].alerts++;
+        return true;
+    }
+
+    // Weak: fuse with what the other sources reported recently
+    state.weakUs = now;
+    state.weakScore = event.score;
+    int64_t windowStart = now - TRIGGER_FUSION_WINDOW_MS * 1000LL;
+    uint16_t total = 0;
+    uint8_t contributors = 0;
+    for (uint8_t i = 0; i < TRIGGER_SRC_COUNT; i++) {
+        if (sources[i].weakUs == 0 || sources[i].weakUs < windowStart) continue;
+        total += sources[i].weakScore;
+        contributors++;
+        if (sources[i].weakScore > decision.score) {
+            decision.source = (TriggerSource)i;
+            decision.score = sources[i].weakScore;
+        }
+    }
+    if (contributors < 2 || total < TRIGGER_FUSION_SCORE) return false;
+
+    decision.alertType = detectors[decision.source].alertType;
+    decision.sources = contributors;
+    decision.record = false;
+    for (uint8_t i = 0; i < TRIGGER_SRC_COUNT; i++) {
+        if (sources[i].weakUs == 0 || sources[i].weakUs < windowStart) continue;
+        if (detectors[i].record) decision.record = true;
+        stats[i].fused++;
+        startCooldown((TriggerSource)i, now);
+    }
+    stats[decision.source].alerts++;
+    return true;
+}
+
+TriggerStats triggerStats(TriggerSource source) {
+    return source < TRIGGER_SRC_COUNT ? stats[source] : TriggerStats{};
+}
+
+void triggerPrintReport(Print &out) {
+    for (uint8_t i = 0; i < TRIGGER_SRC_COUNT; i++) {
+        if (!registered[i]) continue;
+        const TriggerStats &s = stats[i];
+        fixedLog(out, "Trigger %s: %lu events, %lu alerts, %lu fused, %lu in cooldown, %lu rate-limited\n",
+                 detectors[i].name, (unsigned long)s.events, (unsigned long)s.alerts, (unsigned long)s.fused,
+                 (unsigned long)s.cooledDown, (unsigned long)s.rateLimited);
+    }
+}
@@ -0,0 +1,79 @@
+// Trigger sources and the fusion stage that turns their events into alerts
+#pragma once
+
+#include <Arduino.h>
+#include "alert_frame.h"
+#include "app_tasks.h"
+
+// Every detector posts scored APP_EVT_TRIGGER events from its own context
+// (ISR, detector task, IMU task) without blocking, so a slow or chatty
+// source never holds up another. The controller feeds each one through
+// triggerFuse():
+//   - an event inside its source's cooldown is dropped;
+//   - a score at or above the source's alertScore alerts on its own;
+//   - otherwise the latest weak score from each source in the last
+//     TRIGGER_FUSION_WINDOW_MS is summed, and two or more sources reaching
+//     TRIGGER_FUSION_SCORE alert together (FRAME_FLAG_FUSED). Their scores
+//     are used up and every one of them starts its cooldown.
+enum TriggerSource : uint8_t {
+    TRIGGER_SRC_BUTTON,
+    TRIGGER_SRC_AUDIO_PEAK,
+    TRIGGER_SRC_AUDIO_CLASSIFIER,
+    TRIGGER_SRC_IMU_FALL,
+    TRIGGER_SRC_IMU_SHAKE,
+    TRIGGER_SRC_COUNT
+};
+
+#define TRIGGER_SCORE_CERTAIN    255
+#define TRIGGER_FUSION_WINDOW_MS 2000
+#define TRIGGER_FUSION_SCORE     256  // More than any one weak score
+
+// Weak events are rate-limited per source at post time, so a noisy source
+// can't fill appEventQueue ahead of the others
+#define TRIGGER_WEAK_INTERVAL_MS 250
+
+struct TriggerDetector {
+    const char *name;
+    AlertFrameType alertType;         // Reported when this source leads the alert
+    uint8_t alertScore;               // Alone at or above this: alert
+    uint32_t cooldownMs;
+    bool record;                      // Alerts from this source start a clip
+};
+
+struct TriggerStats {
+    uint32_t events;
+    uint32_t alerts;                  // Led, alone or fused
+    uint32_t cooledDown;              // Dropped inside the cooldown
+    uint32_t fused;                   // Contributed to a fused alert
+    uint32_t rateLimited;             // Weak events not posted
+};
+
+// Outcome of an accepted event
+struct TriggerDecision {
+    TriggerSource source;             // Highest score among contributors
+    AlertFrameType alertType;
+    uint8_t score;
+    uint8_t sources;                  // Contributors, 1 unless fused
+    bool record;
+    int64_t timestampUs;              // The event that completed the alert
+};
+
+// Events go to the controller's appEventQueue
+void triggerBegin(QueueHandle_t eventQueue);
+
+// Detector begin() calls, before the source posts anything. Unregistered
+// sources are ignored.
+void triggerRegister(TriggerSource source, const TriggerDetector &detector);
+void triggerSetCooldown(TriggerSource source, uint32_t cooldownMs);
+bool triggerRegistered(TriggerSource source);
+
+// Post a scored event. The ISR variant goes to the front of the queue.
+bool triggerPost(TriggerSource source, uint8_t score, int64_t timestampUs);
+bool triggerPostFromISR(TriggerSource source, uint8_t score, int64_t timestampUs, BaseType_t *woken);
+
+// Controller task, for every APP_EVT_TRIGGER: true and decision filled
+// when the event completes an alert
+bool triggerFuse(const AppEvent &event, TriggerDecision &decision);
+
+TriggerStats triggerStats(TriggerSource source);
+void triggerPrintReport(Print &out);
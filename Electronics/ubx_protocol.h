@@ -0,0 +1,80 @@
+// u-blox UBX message definitions (protocol 15+, M8 and later)
+#pragma once
+
+#include <stdint.h>
+
+#define UBX_SYNC1        0xB5
+#define UBX_SYNC2        0x62
+#define UBX_HEADER_LEN   6            // Sync x2, class, id, u16 length
+#define UBX_MAX_PAYLOAD  100          // Largest message we decode (NAV-PVT is 92)
+
+#define UBX_CLASS_NAV    0x01
+#define UBX_NAV_PVT      0x07
+
+#define UBX_CLASS_CFG    0x06
+#define UBX_CFG_MSG      0x01
+#define UBX_CFG_RATE     0x08
+#define UBX_CFG_RXM      0x11
+
+#define UBX_CLASS_NMEA   0xF0
+
+#define UBX_CLASS_RXM    0x02
+#define UBX_RXM_PMREQ    0x41         // 16-byte form with wakeup sources
+#define UBX_PMREQ_FLAG_BACKUP    0x02
+#define UBX_PMREQ_WAKE_UART_RX   0x08
+#define UBX_WAKE_SETTLE_MS       100  // Bytes sent right after wakeup may be lost
+
+#define UBX_RXM_CONTINUOUS 0
+#define UBX_RXM_POWER_SAVE 1
+
+// NAV-PVT valid bits
+#define UBX_PVT_VALID_DATE     0x01
+#define UBX_PVT_VALID_TIME     0x02
+#define UBX_PVT_FULLY_RESOLVED 0x04
+
+// NAV-PVT flags bits
+#define UBX_PVT_GNSS_FIX_OK    0x01
+
+#define UBX_FIX_2D       2
+#define UBX_FIX_3D       3
+#define UBX_FIX_GNSS_DR  4            // GNSS + dead reckoning
+
+// NAV-PVT payload, decoded in place: the ESP32 is little-endian like the
+// wire format, so the receive buffer is read through this struct directly
+struct __attribute__((packed)) UbxNavPvt {
+    uint32_t iTOW;                    // ms, GPS time of week of the epoch
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t min;
+    uint8_t sec;
+    uint8_t valid;
+    uint32_t tAcc;                    // ns
+    int32_t nano;                     // ns, -1e9..1e9, added to sec
+    uint8_t fixType;
+    uint8_t flags;
+    uint8_t flags2;
+    uint8_t numSV;
+    int32_t lon;                      // deg * 1e7
+    int32_t lat;                      // deg * 1e7
+    int32_t height;                   // mm above ellipsoid
+    int32_t hMSL;                     // mm above mean sea level
+    uint32_t hAcc;                    // mm
+    uint32_t vAcc;                    // mm
+    int32_t velN;                     // mm/s
+    int32_t velE;
+    int32_t velD;
+    int32_t gSpeed;                   // mm/s, ground speed
+    int32_t headMot;                  // deg * 1e5, heading of motion
+    uint32_t sAcc;                    // mm/s
+    uint32_t headAcc;                 // deg * 1e5
+    uint16_t pDOP;                    // * 0.01
+    uint8_t flags3;
+    uint8_t reserved1[5];
+    int32_t headVeh;
+    int16_t magDec;
+    uint16_t magAcc;
+};
+
+static_assert(sizeof(UbxNavPvt) == 92, "NAV-PVT payload is 92 bytes");
@@ -0,0 +1,257 @@
+#include "voice_classifier.h"
+#include "voice_model.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(ESP_PLATFORM) && __has_include("esp_dsp.h")
+#include "esp_dsp.h"
+#define VOICE_USE_ESP_DSP 1
+#else
+#define VOICE_USE_ESP_DSP 0
+#endif
+
+#define VOICE_BINS        (VOICE_FFT_SIZE / 2)
+#define VOICE_BIN_HZ      ((float)VOICE_SAMPLE_RATE / VOICE_FFT_SIZE)
+#define VOICE_MAX_SAMPLES 1024
+#define VOICE_FLAT_MIN_HZ 250.0f
+
+static const float bandEdgesHz[VOICE_BAND_COUNT] = {500.0f, 1000.0f, 2000.0f, 4000.0f, 8000.0f};
+
+// Scratch is static: the capture task stack is only 4KB
+static float window[VOICE_FFT_SIZE];
+static float fftBuf[VOICE_FFT_SIZE * 2];      // Interleaved re/im
+static float power[VOICE_BINS];
+static float signal[VOICE_MAX_SAMPLES];
+static float energyPrefix[VOICE_FFT_SIZE + 1];
+static bool initialized = false;
+
+#if !VOICE_USE_ESP_DSP
+static float twiddle[VOICE_FFT_SIZE];         // cos/sin pairs for N/2 angles
+
+static void fftInit() {
+    for (int i = 0; i < VOICE_FFT_SIZE / 2; i++) {
+        float a = -2.0f * (float)M_PI * i / VOICE_FFT_SIZE;
+        twiddle[2 * i] = cosf(a);
+        twiddle[2 * i + 1] = sinf(a);
+    }
+}
+
+// In-place iterative radix-2 on interleaved complex data
+static void fftRun(float *data) {
+    const int n = VOICE_FFT_SIZE;
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            float tr = data[2 * i], ti = data[2 * i + 1];
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j] = tr;
+            data[2 * j + 1] = ti;
+        }
+    }
+    for (int len = 2; len <= n; len <<= 1) {
+        int stride = n / len;
+        for (int i = 0; i < n; i += len) {
+            for (int k = 0; k < len / 2; k++) {
+                float wr = twiddle[2 * k * stride], wi = twiddle[2 * k * stride + 1];
+                float *a = &data[2 * (i + k)];
+                float *b = &data[2 * (i + k + len / 2)];
+                float br = b[0] * wr - b[1] * wi;
+                float bi = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - br;
+                b[1] = a[1] - bi;
+                a[0] += br;
+                a[1] += bi;
+            }
+        }
+    }
+}
+#endif
+
+static void classifierInit() {
+    for (int i = 0; i < VOICE_FFT_SIZE; i++) {
+        window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / (VOICE_FFT_SIZE - 1));
+    }
+#if VOICE_USE_ESP_DSP
+    dsps_fft2r_init_fc32(NULL, VOICE_FFT_SIZE);
+#else
+    fftInit();
+#endif
+    initialized = true;
+}
+
+// Add the power spectrum of one window starting at src to power[]
+static void accumulateSpectrum(const float *src) {
+    for (int i = 0; i < VOICE_FFT_SIZE; i++) {
+        fftBuf[2 * i] = src[i] * window[i];
+        fftBuf[2 * i + 1] = 0.0f;
+    }
+#if VOICE_USE_ESP_DSP
+    dsps_fft2r_fc32(fftBuf, VOICE_FFT_SIZE);
+    dsps_bit_rev_fc32(fftBuf, VOICE_FFT_SIZE);
+#else
+    fftRun(fftBuf);
+#endif
+    for (int k = 0; k < VOICE_BINS; k++) {
+        float re = fftBuf[2 * k], im = fftBuf[2 * k + 1];
+        power[k] += re * re + im * im;
+    }
+}
+
+static void spectralFeatures(VoiceFeatures &f) {
+    float total = 0.0f;
+    float weighted = 0.0f;
+    float logSum = 0.0f;
+    float flatSum = 0.0f;
+    int flatBins = 0;
+    float bands[VOICE_BAND_COUNT] = {};
+    int band = 0;
+
+    // Bin 0 is DC (already removed), skip it
+    for (int k = 1; k < VOICE_BINS; k++) {
+        float hz = k * VOICE_BIN_HZ;
+        float p = power[k];
+        while (band < VOICE_BAND_COUNT - 1 && hz >= bandEdgesHz[band]) band++;
+        bands[band] += p;
+        total += p;
+        weighted += p * hz;
+        if (hz >= VOICE_FLAT_MIN_HZ) {
+            logSum += logf(p + 1e-3f);
+            flatSum += p;
+            flatBins++;
+        }
+    }
+
+    float inv = total > 0.0f ? 1.0f / total : 0.0f;
+    for (int b = 0; b < VOICE_BAND_COUNT; b++) f.bands[b] = bands[b] * inv;
+    f.centroidHz = weighted * inv;
+    float flatMean = flatSum / flatBins;
+    f.flatness = flatMean > 0.0f ? expf(logSum / flatBins) / flatMean : 1.0f;
+}
+
+// Normalized autocorrelation over one window; the best lag in the pitch
+// range gives both the pitch and how periodic the frame is
+static void pitchFeatures(const float *x, VoiceFeatures &f) {
+    const int w = VOICE_FFT_SIZE;
+    const int minLag = VOICE_SAMPLE_RATE / VOICE_PITCH_MAX_HZ;
+    const int maxLag = VOICE_SAMPLE_RATE / VOICE_PITCH_MIN_HZ;
+
+    energyPrefix[0] = 0.0f;
+    for (int i = 0; i < w; i++) energyPrefix[i + 1] = energyPrefix[i] + x[i] * x[i];
+
+    // r[] spans one lag either side of the range so peaks can be tested
+    float r[VOICE_SAMPLE_RATE / VOICE_PITCH_MIN_HZ + 2];
+    for (int lag = minLag - 1; lag <= maxLag + 1; lag++) {
+        float acc = 0.0f;
+        for (int i = 0; i < w - lag; i++) acc += x[i] * x[i + lag];
+        float e1 = energyPrefix[w - lag];
+        float e2 = energyPrefix[w] - energyPrefix[lag];
+        float norm = sqrtf(e1 * e2);
+        r[lag - minLag + 1] = norm > 0.0f ? acc / norm : 0.0f;
+    }
+
+    // Only local maxima count, so a slow rumble (high r at every short lag)
+    // isn't mistaken for a high pitch. The first peak within 90% of the best
+    // one wins, which avoids locking onto a subharmonic.
+    float best = 0.0f;
+    for (int lag = minLag; lag <= maxLag; lag++) {
+        float v = r[lag - minLag + 1];
+        if (v > r[lag - minLag] && v >= r[lag - minLag + 2] && v > best) best = v;
+    }
+    int bestLag = 0;
+    for (int lag = minLag; lag <= maxLag && best > 0.0f; lag++) {
+        float v = r[lag - minLag + 1];
+        if (v > r[lag - minLag] && v >= r[lag - minLag + 2] && v >= 0.9f * best) {
+            bestLag = lag;
+            best = v;
+            break;
+        }
+    }
+    f.harmonicity = best;
+    f.pitchHz = bestLag > 0 ? (float)VOICE_SAMPLE_RATE / bestLag : 0.0f;
+}
+
+bool voiceExtractFeatures(const int16_t *samples, size_t count, VoiceFeatures &features) {
+    if (!initialized) classifierInit();
+    if (count > VOICE_MAX_SAMPLES) count = VOICE_MAX_SAMPLES;
+
+    float mean = 0.0f;
+    for (size_t i = 0; i < count; i++) mean += samples[i];
+    mean = count > 0 ? mean / count : 0.0f;
+
+    float sumSq = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        float s = samples[i] - mean;
+        signal[i] = s;
+        sumSq += s * s;
+    }
+    float rms = count > 0 ? sqrtf(sumSq / count) : 0.0f;
+    features.energyDb = 20.0f * log10f(rms / 32768.0f + 1e-9f);
+    if (features.energyDb < VOICE_ENERGY_FLOOR_DB || count < VOICE_FFT_SIZE) return false;
+
+    memset(power, 0, sizeof(power));
+    accumulateSpectrum(signal);
+    if (count > VOICE_FFT_SIZE) accumulateSpectrum(&signal[count - VOICE_FFT_SIZE]);
+    spectralFeatures(features);
+
+    // Pitch from the middle of the frame
+    pitchFeatures(&signal[(count - VOICE_FFT_SIZE) / 2], features);
+    return true;
+}
+
+static inline int32_t quantize(float x, const VoiceQuant &q) {
+    float v = (x - q.center) * 127.0f / q.range;
+    if (v > 127.0f) return 127;
+    if (v < -128.0f) return -128;
+    return (int32_t)lroundf(v);
+}
+
+int8_t voiceClassify(const VoiceFeatures &features) {
+    float x[VOICE_FEATURE_COUNT];
+    x[0] = features.energyDb;
+    for (int b = 0; b < VOICE_BAND_COUNT; b++) x[1 + b] = features.bands[b];
+    x[VOICE_BAND_COUNT + 1] = features.centroidHz;
+    x[VOICE_BAND_COUNT + 2] = features.flatness;
+    x[VOICE_BAND_COUNT + 3] = features.pitchHz;
+    x[VOICE_BAND_COUNT + 4] = features.harmonicity;
+
+    int32_t acc = voiceModelBias;
+    for (int i = 0; i < VOICE_FEATURE_COUNT; i++) {
+        acc += voiceModelWeights[i] * quantize(x[i], voiceModelQuant[i]);
+    }
+    acc >>= VOICE_MODEL_SHIFT;
+    if (acc > 127) acc = 127;
+    if (acc < -127) acc = -127;       // -128 is reserved for VOICE_SCORE_SILENT
+    return (int8_t)acc;
+}
+
+int8_t voiceClassifierScore(const int16_t *samples, size_t count) {
+    VoiceFeatures features;
+    if (!voiceExtractFeatures(samples, count, features)) return VOICE_SCORE_SILENT;
+    return voiceClassify(features);
+}
+
+#ifdef DSP_BENCHMARK
+#include <Arduino.h>
+
+void voiceClassifierBenchmark(Print &out) {
+    const int runs = 8;
+    static int16_t buf[800];
+    for (size_t i = 0; i < 800; i++) {
+        // Loud 700Hz tone with a few harmonics
+        float t = (float)i / VOICE_SAMPLE_RATE;
+        buf[i] = (int16_t)(8000.0f * sinf(2.0f * (float)M_PI * 700.0f * t) +
+                           3000.0f * sinf(2.0f * (float)M_PI * 1400.0f * t));
+    }
+
+    volatile int32_t sink = 0;
+    uint32_t start = ESP.getCycleCount();
+    for (int r = 0; r < runs; r++) sink += voiceClassifierScore(buf, 800);
+    uint32_t cycles = (ESP.getCycleCount() - start) / runs;
+    out.printf("Voice classifier (%s FFT): %u cycles/frame, %.1f%% of a 50ms frame\n",
+               VOICE_USE_ESP_DSP ? "esp-dsp" : "portable", (unsigned)cycles,
+               100.0 * cycles / (ESP.getCpuFreqMHz() * 1000.0 * 50));
+}
+#endif
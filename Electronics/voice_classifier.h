@@ -0,0 +1,52 @@
+// Spectral scream classifier: per-frame features feeding an int8 linear model
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Two FFT_SIZE-point Hann windows per 50ms frame (offsets 0 and
+// frame - FFT_SIZE) cover all 800 samples with a little overlap.
+// The esp-dsp radix-2 FFT is used when the core ships it (Arduino-ESP32 2.x
+// does); otherwise a portable float FFT of the same shape.
+#define VOICE_FFT_SIZE        512
+#define VOICE_SAMPLE_RATE     16000
+
+// Pitch search range: adult speech F0 sits below ~300Hz, screams well above
+#define VOICE_PITCH_MIN_HZ    150
+#define VOICE_PITCH_MAX_HZ    1200
+
+// Frames quieter than this skip feature extraction entirely
+#define VOICE_ENERGY_FLOOR_DB -45.0f
+
+#define VOICE_BAND_COUNT      5
+#define VOICE_FEATURE_COUNT   (VOICE_BAND_COUNT + 5)
+
+// Returned for frames below the energy floor
+#define VOICE_SCORE_SILENT    INT8_MIN
+
+struct VoiceFeatures {
+    float energyDb;                   // dBFS of the whole frame
+    float bands[VOICE_BAND_COUNT];    // Energy share: <500, <1k, <2k, <4k, <8k Hz
+    float centroidHz;
+    float flatness;                   // 0 = pure tone, 1 = white noise
+    float pitchHz;                    // Strongest autocorrelation lag in range
+    float harmonicity;                // Normalized autocorrelation at that lag
+};
+
+// Compute the features of one frame. Returns false (features untouched past
+// energyDb) when the frame is below VOICE_ENERGY_FLOOR_DB.
+bool voiceExtractFeatures(const int16_t *samples, size_t count, VoiceFeatures &features);
+
+// Quantize the features and run the model: >0 leans scream, <0 leans
+// anything else, saturated to int8
+int8_t voiceClassify(const VoiceFeatures &features);
+
+// Both steps; VOICE_SCORE_SILENT below the energy floor. Not reentrant:
+// call from one task only (the capture task).
+int8_t voiceClassifierScore(const int16_t *samples, size_t count);
+
+#ifdef DSP_BENCHMARK
+class Print;
+// Cycles per frame for feature extraction plus inference
+void voiceClassifierBenchmark(Print &out);
+#endif
@@ -0,0 +1,63 @@
+#include "voice_detector.h"
+#include "audio_levels.h"
+#include "dsp_kernels.h"
+#include "voice_classifier.h"
+
+void voiceAnalyzeFrame(AudioFrame *frame, VoiceDetector detector, VoiceScoreGate gate) {
+    frame->peak = dspPeakAbs(frame->samples, frame->sample_count);
+    frame->rms = (int16_t)dspRms(frame->samples, frame->sample_count);
+    audioLevelsUpdate(frame->rms);
+    frame->score = VOICE_SCORE_SILENT;
+    if (detector == DETECTOR_CLASSIFIER && (gate == nullptr || gate(frame->peak))) {
+        frame->score = voiceClassifierScore(frame->samples, frame->sample_count);
+    }
+}
+
+bool voiceFrameTriggers(const AudioFrame *frame, VoiceDetector detector) {
+    AudioLevelConfig levels = audioLevelConfig();
+    if (audioLevelDb(frame->rms) < audioNoiseFloorDb() + levels.triggerMarginDb) {
+        return false;
+    }
+    if (detector == DETECTOR_CLASSIFIER) {
+        return frame->score > levels.scoreThreshold;
+    }
+    return frame->peak > levels.minTriggerPeak;
+}
+
+void voiceSustainReset(VoiceSustain &state) {
+    state.active = false;
+    state.consecutive = 0;
+    state.firstUs = 0;
+    state.sustainedMs = 0;
+}
+
+VoiceStep voiceSustainStep(VoiceSustain &state, const AudioFrame *frame, VoiceDetector detector) {
+    if (frame->sample_count == 0) return VOICE_STEP_NONE;
+
+    if (!voiceFrameTriggers(frame, detector)) {
+        state.active = false;
+        state.consecutive = 0;
+        return VOICE_STEP_NONE;
+    }
+
+    VoiceStep step = VOICE_STEP_NONE;
+    if (!state.active) {
+        state.active = true;
+        state.firstUs = frame->timestamp_us;
+        state.consecutive = 1;
+        step = VOICE_STEP_ONSET;
+    } else if (state.consecutive < 255) {
+        state.consecutive++;
+    }
+
+    if (state.consecutive >= TRIGGER_SAMPLES_NEEDED) {
+        // Frame timestamps mark the end of each window, so add the first one back in
+        uint32_t sustained = (uint32_t)((frame->timestamp_us - state.firstUs) / 1000) + AUDIO_FRAME_MS;
+        if (sustained >= SUSTAINED_TRIGGER_TIME) {
+            voiceSustainReset(state);
+            state.sustainedMs = sustained;
+            return VOICE_STEP_ALERT;
+        }
+    }
+    return step;
+}
@@ -0,0 +1,46 @@
+// Per-frame voice detection: levels, the classifier score and the
+// sustained-trigger logic. Platform-neutral, so the host replay harness
+// (host/) runs exactly what the capture and detector tasks run.
+#pragma once
+
+#include <stdint.h>
+#include "audio_frame.h"
+
+// Which per-frame test feeds the sustained-trigger logic
+enum VoiceDetector : uint8_t {
+    DETECTOR_PEAK,                    // peak > minTriggerPeak
+    DETECTOR_CLASSIFIER               // Spectral features + int8 model
+};
+
+// Scream detection: this many consecutive triggering frames, spanning at
+// least SUSTAINED_TRIGGER_TIME, make an alert
+#define SUSTAINED_TRIGGER_TIME 150    // 150ms sustained sound
+#define TRIGGER_SAMPLES_NEEDED 4      // 4 consecutive samples (200ms)
+
+struct VoiceSustain {
+    bool active;
+    uint8_t consecutive;
+    int64_t firstUs;                  // Timestamp of the first triggering frame
+    uint32_t sustainedMs;             // Set when the step returns VOICE_STEP_ALERT
+};
+
+enum VoiceStep : uint8_t {
+    VOICE_STEP_NONE,
+    VOICE_STEP_ONSET,                 // First triggering frame of a run
+    VOICE_STEP_ALERT                  // Run long enough; the sustain state is reset
+};
+
+// Decides whether a frame is worth classifying from its peak (the power
+// manager's sound gate); NULL classifies every frame
+typedef bool (*VoiceScoreGate)(int16_t peak);
+
+// Capture task: fill peak, rms and score, and move the noise floor
+void voiceAnalyzeFrame(AudioFrame *frame, VoiceDetector detector, VoiceScoreGate gate);
+
+// The frame clears the ambient floor by the trigger margin and passes the
+// detector's own test
+bool voiceFrameTriggers(const AudioFrame *frame, VoiceDetector detector);
+
+// Detector task: advance the sustained-trigger run by one analyzed frame
+void voiceSustainReset(VoiceSustain &state);
+VoiceStep voiceSustainStep(VoiceSustain &state, const AudioFrame *frame, VoiceDetector detector);
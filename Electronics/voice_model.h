@@ -0,0 +1,40 @@
+// Int8 scream model used by voice_classifier.cpp
+//
+// Each feature is quantized as q = clamp((x - center) * 127 / range) and the
+// logit is (bias + sum(weight * q)) >> VOICE_MODEL_SHIFT, saturated to int8.
+// The weights are hand-set starting values: loud, harmonic, high-pitched
+// frames with energy in 1-4kHz score high; broadband (slams, claps) and
+// low-frequency (music bass, traffic) frames score low. Replace this table
+// with weights fit to labelled captures from the device.
+#pragma once
+
+#include <stdint.h>
+#include "voice_classifier.h"
+
+#define VOICE_MODEL_SHIFT 5
+
+struct VoiceQuant {
+    float center;
+    float range;
+};
+
+// Order: energyDb, bands[0..4], centroidHz, flatness, pitchHz, harmonicity
+static const VoiceQuant voiceModelQuant[VOICE_FEATURE_COUNT] = {
+    {-25.0f, 20.0f},
+    {0.25f, 0.25f}, {0.25f, 0.25f}, {0.25f, 0.25f}, {0.15f, 0.15f}, {0.10f, 0.10f},
+    {1500.0f, 1500.0f},
+    {0.30f, 0.30f},
+    {500.0f, 500.0f},
+    {0.50f, 0.50f},
+};
+
+static const int8_t voiceModelWeights[VOICE_FEATURE_COUNT] = {
+    6,
+    -6, 2, 5, 3, -3,
+    2,
+    -8,
+    4,
+    10,
+};
+
+static const int32_t voiceModelBias = -1200;
@@ -0,0 +1,275 @@
+#include "wav_recorder.h"
+#include <atomic>
+#include "dsp_kernels.h"
+#include "sd_storage.h"
+#include "adpcm.h"
+#include "trace.h"
+#include "fixed_format.h"
+
+static TaskHandle_t recorderTaskHandle = NULL;
+
+// Set by wavRecorderStart() before busy is raised
+static WavRecordingOptions recOptions;
+static uint32_t readPos = 0;        // Next history sample to write out
+static uint32_t endPos = 0;         // One past the last sample of the clip
+
+static std::atomic<bool> busy{false};
+static void (*doneCallback)() = nullptr;
+static uint32_t dataBytes = 0;
+static uint32_t sampleCount = 0;
+static uint32_t lastDataBytes = 0;
+static uint32_t lastSampleCount = 0;
+static volatile uint32_t droppedChunks = 0;
+static uint64_t encodeCycles = 0;
+static float lastEncodeLoad = 0.0f;
+
+// The only audio buffers the recorder owns; everything else stays in history
+alignas(16) static int16_t workBuf[RECORDER_CHUNK_SAMPLES];
+static AdpcmEncoder encoder;
+static DspAgc agc;
+static uint8_t encodedBuf[(RECORDER_CHUNK_SAMPLES / ADPCM_SAMPLES_PER_BLOCK + 1) * ADPCM_BLOCK_BYTES];
+
+// Runs on the capture task for every frame: wake the writer
+static void recorderTap(const AudioFrame *frame) {
+    if (busy) {
+        xTaskNotifyGive(recorderTaskHandle);
+    }
+}
+
+static size_t writeHeader(uint8_t *wav_header) {
+    if (recOptions.codec == RECORDER_CODEC_IMA_ADPCM) {
+        generate_adpcm_wav_header(wav_header, dataBytes, AUDIO_SAMPLE_RATE, sampleCount);
+        return WAV_ADPCM_HEADER_SIZE;
+    }
+    generate_wav_header(wav_header, dataBytes, AUDIO_SAMPLE_RATE);
+    return WAV_HEADER_SIZE;
+}
+
+static void writeData(const uint8_t *data, size_t bytes) {
+    if (!sdRecordingWrite(data, bytes)) {
+        fixedLog(Serial, "Write error!\n");
+    } else {
+        dataBytes += bytes;
+    }
+}
+
+// Gate, gain and (optionally) encode one chunk of samples
+static void writeSamples(int16_t *samples, size_t count) {
+    if (recOptions.agcTargetPeak > 0) {
+        dspNoiseGate(samples, count, recOptions.noiseThreshold);
+        dspAgcProcess(agc, samples, count);
+    } else {
+        dspGateAndGain(samples, count, recOptions.noiseThreshold, recOptions.gain);
+    }
+    sampleCount += count;
+
+    if (recOptions.codec == RECORDER_CODEC_IMA_ADPCM) {
+        uint32_t start = ESP.getCycleCount();
+        size_t bytes = adpcmEncode(&encoder, samples, count, encodedBuf, sizeof(encodedBuf));
+        encodeCycles += ESP.getCycleCount() - start;
+        if (bytes > 0) writeData(encodedBuf, bytes);
+    } else {
+        writeData((const uint8_t *)samples, count * sizeof(int16_t));
+    }
+}
+
+static void finishRecording() {
+    if (recOptions.codec == RECORDER_CODEC_IMA_ADPCM) {
+        size_t bytes = adpcmFlush(&encoder, encodedBuf, sizeof(encodedBuf));
+        if (bytes > 0) writeData(encodedBuf, bytes);
+
+        // Cycles spent vs cycles that pass while the same audio is captured
+        double budget = (double)sampleCount * ESP.getCpuFreqMHz() * 1e6 / AUDIO_SAMPLE_RATE;
+        lastEncodeLoad = budget > 0 ? (float)(100.0 * encodeCycles / budget) : 0.0f;
+    } else {
+        lastEncodeLoad = 0.0f;
+    }
+
+    // Patch RIFF and data sizes now that the length is known
+    uint8_t wav_header[WAV_ADPCM_HEADER_SIZE];
+    size_t headerSize = writeHeader(wav_header);
+    if (!sdRecordingFinish(wav_header, headerSize)) {
+        fixedLog(Serial, "Failed to finalize WAV file!\n");
+    }
+
+    lastDataBytes = dataBytes;
+    lastSampleCount = sampleCount;
+    busy = false;
+    if (doneCallback != nullptr) doneCallback();
+}
+
+// Write every complete chunk that capture has made available. Pre-roll is
+// simply the part of the clip that is already in history at start time, so
+// it drains first at SD speed before the writer settles in behind capture.
+static void drainHistory() {
+    for (;;) {
+        uint32_t remaining = endPos - readPos;
+        if (remaining == 0) {
+            finishRecording();
+            return;
+        }
+
+        uint32_t ready = audioHistoryPosition() - readPos;
+        size_t n = remaining < RECORDER_CHUNK_SAMPLES ? remaining : RECORDER_CHUNK_SAMPLES;
+        if (ready < n) return;   // Wait for the next frame
+
+        size_t got = audioHistoryRead(readPos, workBuf, n);
+        if (got == 0) {
+            // SD fell so far behind that capture overwrote us: skip to the
+            // oldest safe chunk and keep going
+            droppedChunks++;
+            uint32_t head = audioHistoryPosition();
+            uint32_t oldest = head - audioHistoryAvailable() + RECORDER_CHUNK_SAMPLES;
+            int32_t skip = (int32_t)(oldest - readPos);
+            if (skip <= 0) skip = n;
+            if ((uint32_t)skip > head - readPos) skip = head - readPos;
+            readPos += (uint32_t)skip < remaining ? (uint32_t)skip : remaining;
+            continue;
+        }
+
+        writeSamples(workBuf, got);
+        readPos += got;
+    }
+}
+
+static void recorderTask(void *arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (busy) {
+            drainHistory();
+        }
+    }
+}
+
+bool wavRecorderBegin() {
+    if (recorderTaskHandle != NULL) return true;
+    if (audioHistoryCapacity() == 0) return false;
+
+    BaseType_t ok = xTaskCreatePinnedToCore(recorderTask, "wav_recorder", RECORDER_TASK_STACK,
+                                            NULL, RECORDER_TASK_PRIORITY, &recorderTaskHandle,
+                                            RECORDER_TASK_CORE);
+    if (ok != pdPASS) return false;
+
+    audioCaptureSetTap(recorderTap);
+    return true;
+}
+
+bool wavRecorderReady() {
+    return recorderTaskHandle != NULL;
+}
+
+// Pre-roll plus live audio, encoded, plus the header
+uint32_t wavRecorderExpectedBytes(const WavRecordingOptions &options) {
+    uint64_t samples = (uint64_t)AUDIO_SAMPLE_RATE * (options.prerollMs + options.durationMs) / 1000;
+    return options.codec == RECORDER_CODEC_IMA_ADPCM
+        ? (uint32_t)((samples + ADPCM_SAMPLES_PER_BLOCK - 1) / ADPCM_SAMPLES_PER_BLOCK * ADPCM_BLOCK_BYTES) + WAV_ADPCM_HEADER_SIZE
+        : (uint32_t)(samples * sizeof(int16_t)) + WAV_HEADER_SIZE;
+}
+
+bool wavRecorderStart(const char *filename, const WavRecordingOptions &options) {
+    if (recorderTaskHandle == NULL || busy) return false;
+
+    // Preallocate for the whole clip
+    if (!sdRecordingOpen(filename, wavRecorderExpectedBytes(options))) {
+        fixedLog(Serial, "Failed to create WAV file!\n");
+        return false;
+    }
+
+    recOptions = options;
+    dataBytes = 0;
+    sampleCount = 0;
+    encodeCycles = 0;
+    adpcmInit(&encoder);
+    dspAgcInit(agc, options.agcTargetPeak, options.gain);
+
+    // Placeholder sizes, patched in finishRecording()
+    uint8_t wav_header[WAV_ADPCM_HEADER_SIZE];
+    sdRecordingWrite(wav_header, writeHeader(wav_header));
+
+    // Leave one chunk of headroom so the oldest pre-roll isn't overwritten
+    // before the writer gets to it
+    uint32_t preroll = (uint32_t)((uint64_t)AUDIO_SAMPLE_RATE * options.prerollMs / 1000);
+    uint32_t held = audioHistoryAvailable();
+    uint32_t safe = held > RECORDER_CHUNK_SAMPLES ? held - RECORDER_CHUNK_SAMPLES : 0;
+    if (preroll > safe) preroll = safe;
+
+    uint32_t now = audioHistoryPosition();
+    readPos = now - preroll;
+    endPos = now + (uint32_t)((uint64_t)AUDIO_SAMPLE_RATE * options.durationMs / 1000);
+    busy = true;
+
+    // Start on the pre-roll right away rather than waiting for the next frame
+    xTaskNotifyGive(recorderTaskHandle);
+    return true;
+}
+
+bool wavRecorderBusy() {
+    return busy;
+}
+
+void wavRecorderSetDoneCallback(void (*callback)()) {
+    doneCallback = callback;
+}
+
+uint32_t wavRecorderLastDataBytes() {
+    return lastDataBytes;
+}
+
+uint32_t wavRecorderLastDurationMs() {
+    return (uint32_t)((uint64_t)lastSampleCount * 1000 / AUDIO_SAMPLE_RATE);
+}
+
+uint32_t wavRecorderDroppedChunks() {
+    return droppedChunks;
+}
+
+float wavRecorderEncodeLoad() {
+    return lastEncodeLoad;
+}
+
+void generate_wav_header(uint8_t *wav_header, uint32_t wav_size, uint32_t sample_rate) {
+  uint32_t file_size = wav_size + WAV_HEADER_SIZE - 8;
+  uint32_t byte_rate = sample_rate * 16 / 8;
+  const uint8_t set_wav_header[] = {
+    'R', 'I', 'F', 'F',
+    (uint8_t)file_size, (uint8_t)(file_size >> 8), (uint8_t)(file_size >> 16), (uint8_t)(file_size >> 24),
+    'W', 'A', 'V', 'E',
+    'f', 'm', 't', ' ',
+    0x10, 0x00, 0x00, 0x00,
+    0x01, 0x00,
+    0x01, 0x00,
+    (uint8_t)sample_rate, (uint8_t)(sample_rate >> 8), (uint8_t)(sample_rate >> 16), (uint8_t)(sample_rate >> 24),
+    (uint8_t)byte_rate, (uint8_t)(byte_rate >> 8), (uint8_t)(byte_rate >> 16), (uint8_t)(byte_rate >> 24),
+    0x02, 0x00,
+    0x10, 0x00,
+    'd', 'a', 't', 'a',
+    (uint8_t)wav_size, (uint8_t)(wav_size >> 8), (uint8_t)(wav_size >> 16), (uint8_t)(wav_size >> 24),
+  };
+  memcpy(wav_header, set_wav_header, sizeof(set_wav_header));
+}
+
+void generate_adpcm_wav_header(uint8_t *wav_header, uint32_t wav_size, uint32_t sample_rate, uint32_t sample_count) {
+  uint32_t file_size = wav_size + WAV_ADPCM_HEADER_SIZE - 8;
+  uint32_t byte_rate = sample_rate * ADPCM_BLOCK_BYTES / ADPCM_SAMPLES_PER_BLOCK;
+  const uint8_t set_wav_header[] = {
+    'R', 'I', 'F', 'F',
+    (uint8_t)file_size, (uint8_t)(file_size >> 8), (uint8_t)(file_size >> 16), (uint8_t)(file_size >> 24),
+    'W', 'A', 'V', 'E',
+    'f', 'm', 't', ' ',
+    0x14, 0x00, 0x00, 0x00,
+    0x11, 0x00,                                   // IMA ADPCM
+    0x01, 0x00,
+    (uint8_t)sample_rate, (uint8_t)(sample_rate >> 8), (uint8_t)(sample_rate >> 16), (uint8_t)(sample_rate >> 24),
+    (uint8_t)byte_rate, (uint8_t)(byte_rate >> 8), (uint8_t)(byte_rate >> 16), (uint8_t)(byte_rate >> 24),
+    (uint8_t)ADPCM_BLOCK_BYTES, (uint8_t)(ADPCM_BLOCK_BYTES >> 8),
+    0x04, 0x00,
+    0x02, 0x00,                                   // cbSize
+    (uint8_t)ADPCM_SAMPLES_PER_BLOCK, (uint8_t)(ADPCM_SAMPLES_PER_BLOCK >> 8),
+    'f', 'a', 'c', 't',
+    0x04, 0x00, 0x00, 0x00,
+    (uint8_t)sample_count, (uint8_t)(sample_count >> 8), (uint8_t)(sample_count >> 16), (uint8_t)(sample_count >> 24),
+    'd', 'a', 't', 'a',
+    (uint8_t)wav_size, (uint8_t)(wav_size >> 8), (uint8_t)(wav_size >> 16), (uint8_t)(wav_size >> 24),
+  };
+  memcpy(wav_header, set_wav_header, sizeof(set_wav_header));
+}
@@ -0,0 +1,68 @@
+// Streaming WAV recorder - writes capture frames to SD while capture continues
+#pragma once
+
+#include <Arduino.h>
+#include "audio_capture.h"
+
+#define WAV_HEADER_SIZE 44
+#define WAV_ADPCM_HEADER_SIZE 60          // fmt extension + fact chunk
+
+// The recorder reads straight out of the capture history (see
+// audioHistoryBegin), so its only buffer is one RECORDER_CHUNK_BYTES work
+// chunk. SD stalls are absorbed by the history margin.
+#define RECORDER_CHUNK_BYTES   4096
+#define RECORDER_CHUNK_SAMPLES (RECORDER_CHUNK_BYTES / sizeof(int16_t))
+
+// Writer task runs on core 0, away from the capture task
+#define RECORDER_TASK_CORE     0
+#define RECORDER_TASK_PRIORITY 3
+#define RECORDER_TASK_STACK    4096
+
+// Opus/LC3 would need a vendored codec library; IMA-ADPCM is 4:1, needs no
+// tables beyond 105 bytes and encodes in well under 1% of one core
+enum RecorderCodec {
+    RECORDER_CODEC_PCM16,
+    RECORDER_CODEC_IMA_ADPCM
+};
+
+struct WavRecordingOptions {
+    uint32_t durationMs;
+    uint32_t prerollMs;               // Taken from history, as much as is held
+    int gain;                         // Fixed gain, or the AGC's maximum gain
+    int noiseThreshold;               // Gate: |x| below this is zeroed before gain
+    int16_t agcTargetPeak;            // 0 = fixed gain, else AGC towards this peak
+    RecorderCodec codec;
+};
+
+// Create the writer task and attach to the capture stream. SD must be
+// mounted and the capture history allocated.
+bool wavRecorderBegin();
+
+// wavRecorderBegin() succeeded: SD, history and the writer task are there
+bool wavRecorderReady();
+
+// Size of the file a recording with these options comes to, at most
+uint32_t wavRecorderExpectedBytes(const WavRecordingOptions &options);
+
+// Open filename and record the pre-roll followed by durationMs of live
+// audio. Returns immediately; false if busy or the file can't be created.
+bool wavRecorderStart(const char *filename, const WavRecordingOptions &options);
+
+// True from wavRecorderStart() until the file has been finalized and closed
+bool wavRecorderBusy();
+
+// Called on the writer task once busy drops. Must not block.
+void wavRecorderSetDoneCallback(void (*callback)());
+
+// Bytes of audio data in the last finished recording, and chunks skipped
+// because the SD card fell behind by more than the history margin
+uint32_t wavRecorderLastDataBytes();
+uint32_t wavRecorderLastDurationMs();
+uint32_t wavRecorderDroppedChunks();
+
+// Encoder cost of the last recording as a percentage of one core in real
+// time (0 for PCM). Well under 100 means encoding keeps up with capture.
+float wavRecorderEncodeLoad();
+
+void generate_wav_header(uint8_t *wav_header, uint32_t wav_size, uint32_t sample_rate);
+void generate_adpcm_wav_header(uint8_t *wav_header, uint32_t wav_size, uint32_t sample_rate, uint32_t sample_count);
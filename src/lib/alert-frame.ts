@@ -0,0 +1,214 @@
+// Decoder for the SHIELD device's binary TX frames
+// Mirrors Electronics/alert_frame.h: little-endian fields, CRC-16/CCITT-FALSE trailer
+
+export const FRAME_VERSION = 2;
+export const FRAME_KIND_ALERT = 1;
+export const ALERT_FRAME_SIZE = 24;
+const ALERT_FRAME_SIZE_V1 = 20;
+
+const FRAME_LAT_UNKNOWN = -0x80000000;
+const FRAME_HDOP_UNKNOWN = 0xff;
+const FRAME_FIX_AGE_UNKNOWN = 0xffff;
+const FRAME_ACC_UNKNOWN = 0;
+
+const FRAME_FLAG_FIX_CACHED = 0x01;
+const FRAME_FLAG_DEAD_RECKONED = 0x02;
+const FRAME_FLAG_CLOCK_TIME = 0x04;
+const FRAME_FLAG_REPLAYED = 0x08;
+const FRAME_FLAG_FUSED = 0x10;
+
+export type AlertFrameType = 'voice' | 'pin' | 'test' | 'motion';
+
+const ALERT_TYPES: AlertFrameType[] = ['voice', 'pin', 'test', 'motion'];
+
+export interface AlertFrame {
+    alertType: AlertFrameType;
+    seq: number;
+    location?: {
+        latitude: number;
+        longitude: number;
+        accuracy?: number;            // metres, version 2 frames with a UBX fix
+    };
+    utc?: Date;
+    hdop?: number;
+    satellites: number;
+    // Version 2 frames: how old the position is and where it came from
+    fixAgeSeconds?: number;
+    fixCached: boolean;
+    deadReckoned: boolean;
+    clockTime: boolean;
+    // Delivered late from the device's alert log, not as it happened
+    replayed: boolean;
+    // Raised by weak events from several detectors together
+    fused: boolean;
+}
+
+export function frameCrc16(bytes: Uint8Array, length: number): number {
+    let crc = 0xffff;
+    for (let i = 0; i < length; i++) {
+        crc ^= bytes[i] << 8;
+        for (let b = 0; b < 8; b++) {
+            crc = crc & 0x8000 ? ((crc << 1) ^ 0x1021) & 0xffff : (crc << 1) & 0xffff;
+        }
+    }
+    return crc;
+}
+
+// Binary frames start with a control character (version << 4 | kind);
+// legacy text messages always start with a printable character
+export function isBinaryFrame(view: DataView): boolean {
+    if (view.byteLength === 0) return false;
+    const version = view.getUint8(0) >> 4;
+    return version >= 1 && version <= FRAME_VERSION;
+}
+
+function hasValidCrc(view: DataView, size: number): boolean {
+    const bytes = new Uint8Array(view.buffer, view.byteOffset, size);
+    return frameCrc16(bytes, size - 2) === view.getUint16(size - 2, true);
+}
+
+function decodeFixInfo(view: DataView, version: number) {
+    if (version < 2) {
+        return { fixCached: false, deadReckoned: false, clockTime: false, replayed: false, fused: false };
+    }
+    const age = view.getUint16(18, true);
+    const flags = view.getUint8(20);
+    return {
+        fixAgeSeconds: age === FRAME_FIX_AGE_UNKNOWN ? undefined : age,
+        fixCached: (flags & FRAME_FLAG_FIX_CACHED) !== 0,
+        deadReckoned: (flags & FRAME_FLAG_DEAD_RECKONED) !== 0,
+        clockTime: (flags & FRAME_FLAG_CLOCK_TIME) !== 0,
+        replayed: (flags & FRAME_FLAG_REPLAYED) !== 0,
+        fused: (flags & FRAME_FLAG_FUSED) !== 0,
+    };
+}
+
+export function decodeAlertFrame(view: DataView): AlertFrame | null {
+    if (view.byteLength === 0 || (view.getUint8(0) & 0x0f) !== FRAME_KIND_ALERT) return null;
+    const version = view.getUint8(0) >> 4;
+    const size = version === 1 ? ALERT_FRAME_SIZE_V1 : ALERT_FRAME_SIZE;
+    if (version < 1 || version > FRAME_VERSION) return null;
+    if (view.byteLength < size || !hasValidCrc(view, size)) return null;
+
+    const latE7 = view.getInt32(4, true);
+    const lngE7 = view.getInt32(8, true);
+    const utc = view.getUint32(12, true);
+    const hdop = view.getUint8(16);
+
+    return {
+        alertType: ALERT_TYPES[view.getUint8(1)] ?? 'pin',
+        seq: view.getUint16(2, true),
+        location: latE7 === FRAME_LAT_UNKNOWN ? undefined : {
+            latitude: latE7 / 1e7,
+            longitude: lngE7 / 1e7,
+            accuracy: version >= 2 && view.getUint8(21) !== FRAME_ACC_UNKNOWN ? view.getUint8(21) : undefined,
+        },
+        utc: utc === 0 ? undefined : new Date(utc * 1000),
+        hdop: hdop === FRAME_HDOP_UNKNOWN ? undefined : hdop / 10,
+        satellites: view.getUint8(17),
+        ...decodeFixInfo(view, version),
+    };
+}
+
+// Advertised by a device with no central connected: manufacturer data
+// under BEACON_COMPANY_ID, carrying the newest undelivered alert
+export const FRAME_KIND_BEACON = 4;
+export const BEACON_COMPANY_ID = 0xffff;
+export const ALERT_BEACON_SIZE = 19;
+
+// From the advertisement's manufacturer data, company ID included. The
+// beacon has no HDOP, satellites or fix age; the full frame follows on
+// connect from the device's alert log.
+export function decodeBeaconFrame(view: DataView): AlertFrame | null {
+    if (view.byteLength < 2 + ALERT_BEACON_SIZE || view.getUint16(0, true) !== BEACON_COMPANY_ID) return null;
+    const frame = new DataView(view.buffer, view.byteOffset + 2, ALERT_BEACON_SIZE);
+    if (frame.getUint8(0) !== ((FRAME_VERSION << 4) | FRAME_KIND_BEACON)) return null;
+    if (!hasValidCrc(frame, ALERT_BEACON_SIZE)) return null;
+
+    const latE7 = frame.getInt32(4, true);
+    const utc = frame.getUint32(12, true);
+    const flags = frame.getUint8(16);
+    return {
+        alertType: ALERT_TYPES[frame.getUint8(1)] ?? 'pin',
+        seq: frame.getUint16(2, true),
+        location: latE7 === FRAME_LAT_UNKNOWN ? undefined : {
+            latitude: latE7 / 1e7,
+            longitude: frame.getInt32(8, true) / 1e7,
+        },
+        utc: utc === 0 ? undefined : new Date(utc * 1000),
+        satellites: 0,
+        fixCached: (flags & FRAME_FLAG_FIX_CACHED) !== 0,
+        deadReckoned: (flags & FRAME_FLAG_DEAD_RECKONED) !== 0,
+        clockTime: (flags & FRAME_FLAG_CLOCK_TIME) !== 0,
+        replayed: false,
+        fused: (flags & FRAME_FLAG_FUSED) !== 0,
+    };
+}
+
+export const FRAME_KIND_STATUS = 3;
+
+const STATUS_FIELD_MODE = 0x01;
+const STATUS_FIELD_BATTERY = 0x02;
+const STATUS_FIELD_GPS = 0x04;
+const STATUS_FIELD_NOISE = 0x08;
+const STATUS_FIELD_ALERTS = 0x10;
+const STATUS_FIELD_ALL = 0x1f;
+const STATUS_MODE_LOW_POWER = 0x80;
+const STATUS_BATTERY_UNKNOWN = 0xff;
+
+const STATUS_MODES = ['monitoring', 'alerting', 'recording'] as const;
+
+// Device status as last reported; fields missing from a delta frame keep
+// their previous value (see mergeStatusFrame)
+export interface DeviceStatus {
+    mode?: (typeof STATUS_MODES)[number];
+    lowPower?: boolean;
+    batteryPercent?: number;
+    gpsFixFresh?: boolean;
+    gpsFixCached?: boolean;
+    gpsClock?: boolean;
+    gpsBackup?: boolean;
+    satellites?: number;
+    noiseFloorDb?: number;
+    alertsPending?: number;
+}
+
+export function isStatusFrame(view: DataView): boolean {
+    return view.byteLength > 0 && (view.getUint8(0) & 0x0f) === FRAME_KIND_STATUS;
+}
+
+// Fold a status frame into the previous status; a full frame (every field
+// bit set) replaces it. Returns null for a malformed frame.
+export function mergeStatusFrame(previous: DeviceStatus, view: DataView): DeviceStatus | null {
+    if (view.byteLength < 4 || !isStatusFrame(view)) return null;
+    if (!hasValidCrc(view, view.byteLength)) return null;
+
+    const mask = view.getUint8(1);
+    const status: DeviceStatus = mask === STATUS_FIELD_ALL ? {} : { ...previous };
+    let offset = 2;
+    if (mask & STATUS_FIELD_MODE) {
+        const mode = view.getUint8(offset++);
+        status.mode = STATUS_MODES[mode & 0x7f];
+        status.lowPower = (mode & STATUS_MODE_LOW_POWER) !== 0;
+    }
+    if (mask & STATUS_FIELD_BATTERY) {
+        const battery = view.getUint8(offset++);
+        status.batteryPercent = battery === STATUS_BATTERY_UNKNOWN ? undefined : battery;
+    }
+    if (mask & STATUS_FIELD_GPS) {
+        const flags = view.getUint8(offset++);
+        status.gpsFixFresh = (flags & 0x01) !== 0;
+        status.gpsFixCached = (flags & 0x02) !== 0;
+        status.gpsClock = (flags & 0x04) !== 0;
+        status.gpsBackup = (flags & 0x08) !== 0;
+        status.satellites = view.getUint8(offset++);
+    }
+    if (mask & STATUS_FIELD_NOISE) {
+        status.noiseFloorDb = view.getInt8(offset++);
+    }
+    if (mask & STATUS_FIELD_ALERTS) {
+        status.alertsPending = view.getUint16(offset, true);
+        offset += 2;
+    }
+    return offset + 2 === view.byteLength ? status : null;
+}
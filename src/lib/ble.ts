@@ -8,6 +8,8 @@ const { Geolocation } = (window as any).Capacitor?.Plugins || {};
 
 // Import WiFi service
 import { wifiService, type WiFiDevice, type WiFiData } from './wifi';
+import { decodeAlertFrame, isBinaryFrame, isStatusFrame, mergeStatusFrame, type DeviceStatus } from './alert-frame';
+import { CMD_ACK_ALERT, decodeResponse, encodeIndexCommand, isResponseFrame } from './device-commands';
 
 // Only minimal fallback types for web Bluetooth
 // (Do not redeclare global interfaces that may conflict with browser types)
@@ -52,6 +54,12 @@ export interface BLEConnectionState {
 export const BLE_CONFIG = {
     SERVICE_UUID: "4fafc201-1fb5-459e-8fcc-c5c9c331914b",
     CHARACTERISTIC_UUID: "beb5483e-36e1-4688-b7f5-ea07361b26a8",
+    // SHIELD firmware (Electronics/main.cpp): TX notifies binary frames
+    // (alert-frame.ts), RX takes binary commands (device-commands.ts)
+    SHIELD_SERVICE_UUID: "6e400001-b5a3-f393-e0a9-e50e24dcca9e",
+    COMMAND_CHARACTERISTIC_UUID: "6e400002-b5a3-f393-e0a9-e50e24dcca9e",
+    TX_CHARACTERISTIC_UUID: "6e400003-b5a3-f393-e0a9-e50e24dcca9e",
+    SHIELD_DEVICE_NAME: "SHIELD",
     TARGET_DEVICE_NAME: "ESP32-THAT-PROJECT",
     SCAN_TIMEOUT: 3000, // 3 seconds
     MAX_DATA_BUFFER_SIZE: 20,
@@ -63,6 +71,7 @@ export const BLE_CONFIG = {
 
 class BLEService {
     private device: BLEDevice | null = null;
+    private deviceStatus: DeviceStatus = {};
     private connectionState: BLEConnectionState = {
         isConnected: false,
         isScanning: false,
@@ -78,6 +87,8 @@ class BLEService {
     private reconnectAttempts = 0;
     private reconnectTimer: NodeJS.Timeout | null = null;
     private notificationListener: (() => void) | null = null;
+    // Web Bluetooth only: RX on a SHIELD device, for alert acks
+    private webCommandCharacteristic: any = null;
     private isCapacitor = false;
 
     constructor() {
@@ -249,7 +260,7 @@ class BLEService {
                     console.log('🔍 Testing scan to trigger permissions...');
                     await BleClient.requestLEScan(
                         {
-                            services: [BLE_CONFIG.SERVICE_UUID],
+                            services: [BLE_CONFIG.SHIELD_SERVICE_UUID, BLE_CONFIG.SERVICE_UUID],
                             allowDuplicates: false,
                         },
                         () => {
@@ -434,14 +445,15 @@ class BLEService {
         try {
             await BleClient.requestLEScan(
                 {
-                    services: [BLE_CONFIG.SERVICE_UUID],
+                    services: [BLE_CONFIG.SHIELD_SERVICE_UUID, BLE_CONFIG.SERVICE_UUID],
                     allowDuplicates: false,
                 },
                 (result: any) => {
                     console.log('📡 Found device:', result.device.name);
 
                     if (result.device.name &&
-                        (result.device.name === BLE_CONFIG.TARGET_DEVICE_NAME ||
+                        (result.device.name === BLE_CONFIG.SHIELD_DEVICE_NAME ||
+                            result.device.name === BLE_CONFIG.TARGET_DEVICE_NAME ||
                             result.device.name.startsWith('ESP32'))) {
 
                         const bleDevice: BLEDevice = {
@@ -484,10 +496,12 @@ class BLEService {
     private async startWebDiscovery(): Promise<BLEDevice[]> {
         const device = await navigator.bluetooth!.requestDevice({
             filters: [
+                { name: BLE_CONFIG.SHIELD_DEVICE_NAME },
+                { services: [BLE_CONFIG.SHIELD_SERVICE_UUID] },
                 { name: BLE_CONFIG.TARGET_DEVICE_NAME },
                 { namePrefix: 'ESP32' },
             ],
-            optionalServices: [BLE_CONFIG.SERVICE_UUID],
+            optionalServices: [BLE_CONFIG.SHIELD_SERVICE_UUID, BLE_CONFIG.SERVICE_UUID],
             acceptAllDevices: false,
         });
 
@@ -544,18 +558,20 @@ class BLEService {
             console.log('✅ Connected to device');
 
             // Discover services
+            // SHIELD firmware first, the legacy sensor service otherwise
             const services: BleService[] = await BleClient.getServices(bleDevice.deviceId);
-            const targetService = services.find((s: BleService) => s.uuid === BLE_CONFIG.SERVICE_UUID);
+            const isShield = services.some((s: BleService) => s.uuid === BLE_CONFIG.SHIELD_SERVICE_UUID);
+            const isLegacy = services.some((s: BleService) => s.uuid === BLE_CONFIG.SERVICE_UUID);
 
-            if (!targetService) {
+            if (!isShield && !isLegacy) {
                 throw new Error('Required service not found');
             }
 
             // Enable notifications directly using known UUIDs
             await BleClient.startNotifications(
                 bleDevice.deviceId,
-                BLE_CONFIG.SERVICE_UUID,
-                BLE_CONFIG.CHARACTERISTIC_UUID,
+                isShield ? BLE_CONFIG.SHIELD_SERVICE_UUID : BLE_CONFIG.SERVICE_UUID,
+                isShield ? BLE_CONFIG.TX_CHARACTERISTIC_UUID : BLE_CONFIG.CHARACTERISTIC_UUID,
                 (value: DataView) => {
                     this.handleDataReceived(value);
                 }
@@ -583,7 +599,7 @@ class BLEService {
         // Web Bluetooth implementation (existing code)
         const device = await navigator.bluetooth!.requestDevice({
             filters: [{ name: bleDevice.name }],
-            optionalServices: [BLE_CONFIG.SERVICE_UUID],
+            optionalServices: [BLE_CONFIG.SHIELD_SERVICE_UUID, BLE_CONFIG.SERVICE_UUID],
         });
 
         const server = await device.gatt?.connect();
@@ -591,12 +607,18 @@ class BLEService {
             throw new Error('Failed to connect to GATT server');
         }
 
-        const service = await server.getPrimaryService(BLE_CONFIG.SERVICE_UUID);
+        // SHIELD firmware first, the legacy sensor service otherwise
+        const shieldService = await server.getPrimaryService(BLE_CONFIG.SHIELD_SERVICE_UUID).catch(() => null);
+        const service = shieldService ?? await server.getPrimaryService(BLE_CONFIG.SERVICE_UUID);
         if (!service) {
             throw new Error('Required service not found');
         }
 
-        const characteristic = await service.getCharacteristic(BLE_CONFIG.CHARACTERISTIC_UUID);
+        this.webCommandCharacteristic = shieldService
+            ? await shieldService.getCharacteristic(BLE_CONFIG.COMMAND_CHARACTERISTIC_UUID)
+            : null;
+        const characteristic = await service.getCharacteristic(
+            shieldService ? BLE_CONFIG.TX_CHARACTERISTIC_UUID : BLE_CONFIG.CHARACTERISTIC_UUID);
         if (!characteristic) {
             throw new Error('Required characteristic not found');
         }
@@ -620,6 +642,11 @@ class BLEService {
 
     // Handle received data
     private async handleDataReceived(value: DataView): Promise<void> {
+        if (isBinaryFrame(value)) {
+            this.handleBinaryFrame(value);
+            return;
+        }
+
         try {
             // Convert DataView to string
             const decoder = new TextDecoder('utf-8');
@@ -670,6 +697,70 @@ class BLEService {
         }
     }
 
+    // Handle binary frames from the SHIELD firmware (see alert-frame.ts)
+    private handleBinaryFrame(value: DataView): void {
+        if (isStatusFrame(value)) {
+            const status = mergeStatusFrame(this.deviceStatus, value);
+            if (!status) {
+                console.warn('⚠️ Dropping malformed status frame');
+                return;
+            }
+            this.deviceStatus = status;
+            console.log('📟 Device status:', status);
+            return;
+        }
+
+        if (isResponseFrame(value)) {
+            const response = decodeResponse(value);
+            console.log('📨 Command response:', response ?? 'malformed');
+            return;
+        }
+
+        const frame = decodeAlertFrame(value);
+        if (!frame) {
+            console.warn('⚠️ Dropping malformed binary frame');
+            return;
+        }
+
+        console.log('🚨 Alert frame:', frame);
+        this.ackAlert(frame.seq);
+        if (frame.replayed) {
+            console.log(`📬 Alert #${frame.seq} delivered late from the device log`);
+        }
+        if (frame.location && frame.fixCached) {
+            console.log(`📍 Last-known position, ${frame.fixAgeSeconds ?? '?'}s old${frame.deadReckoned ? ' (dead-reckoned)' : ''}`);
+        }
+
+        const bleData: BLEData = {
+            value: 0,
+            timestamp: frame.utc ? frame.utc.getTime() : Date.now(),
+            status: `${frame.alertType}_alert`,
+            location: frame.location,
+        };
+
+        this.updateDataBuffer(bleData);
+        this.updateState({
+            lastData: bleData,
+        });
+    }
+
+    // The device keeps every alert until it is acked and replays the rest on
+    // reconnect; duplicates (same seq) can arrive if an ack is lost
+    private async ackAlert(seq: number): Promise<void> {
+        const command = encodeIndexCommand(CMD_ACK_ALERT, seq & 0xff, seq);
+        const deviceId = this.device?.deviceId;
+        try {
+            if (deviceId) {
+                await BleClient.write(deviceId, BLE_CONFIG.SHIELD_SERVICE_UUID,
+                    BLE_CONFIG.COMMAND_CHARACTERISTIC_UUID, command);
+            } else if (this.webCommandCharacteristic) {
+                await this.webCommandCharacteristic.writeValue(command);
+            }
+        } catch (error) {
+            console.warn('⚠️ Alert ack failed:', error);
+        }
+    }
+
     // Smart data parser (handles both simple string and JSON formats)
     private smartDataParser(rawData: string): { value: number; status: string; battery?: number } {
         try {
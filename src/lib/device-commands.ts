@@ -0,0 +1,114 @@
+// Binary command protocol on the SHIELD RX characteristic
+// Mirrors Electronics/command_protocol.h; responses arrive on TX as FRAME_KIND_RESPONSE frames
+
+import { frameCrc16, FRAME_VERSION } from './alert-frame';
+
+export const FRAME_KIND_RESPONSE = 2;
+const CMD_RESPONSE_BIT = 0x80;
+
+export const CMD_GET_CONFIG = 0x01;
+export const CMD_SET_CONFIG = 0x02;
+export const CMD_RESET_CONFIG = 0x03;
+export const CMD_TEST_ALERT = 0x04;
+export const CMD_LIST_RECORDINGS = 0x05;
+export const CMD_FETCH_RECORDING = 0x06;
+export const CMD_GET_STATS = 0x07;
+export const CMD_ACK_ALERT = 0x08;
+
+export const CMD_STATUS_OK = 0;
+
+export const CONFIG_KEYS = {
+    triggerMarginDb: 1,
+    minTriggerPeak: 2,
+    scoreThreshold: 3,
+    gateMarginDb: 4,
+    agcTargetPeak: 5,
+    agcMaxGain: 6,
+    cooldownMs: 7,
+    recordSeconds: 8,
+    heartbeatMs: 9,
+    detector: 10,
+} as const;
+
+export type ConfigKey = keyof typeof CONFIG_KEYS;
+
+export interface CommandResponse {
+    op: number;
+    seq: number;
+    status: number;
+    payload: DataView;
+}
+
+export interface RecordingEntry {
+    name: string;
+    size: number;
+}
+
+export function encodeCommand(op: number, seq: number, payload: Uint8Array = new Uint8Array(0)): DataView {
+    const bytes = new Uint8Array(2 + payload.length);
+    bytes[0] = op;
+    bytes[1] = seq & 0xff;
+    bytes.set(payload, 2);
+    return new DataView(bytes.buffer);
+}
+
+export function encodeSetConfig(seq: number, values: Partial<Record<ConfigKey, number>>): DataView {
+    const entries = Object.entries(values) as [ConfigKey, number][];
+    const payload = new DataView(new ArrayBuffer(entries.length * 5));
+    entries.forEach(([key, value], i) => {
+        payload.setUint8(i * 5, CONFIG_KEYS[key]);
+        payload.setInt32(i * 5 + 1, value, true);
+    });
+    return encodeCommand(CMD_SET_CONFIG, seq, new Uint8Array(payload.buffer));
+}
+
+export function encodeIndexCommand(op: number, seq: number, index: number): DataView {
+    return encodeCommand(op, seq, new Uint8Array([index & 0xff, (index >> 8) & 0xff]));
+}
+
+export function isResponseFrame(view: DataView): boolean {
+    return view.byteLength > 0 && (view.getUint8(0) & 0x0f) === FRAME_KIND_RESPONSE;
+}
+
+export function decodeResponse(view: DataView): CommandResponse | null {
+    if (view.byteLength < 6 || !isResponseFrame(view)) return null;
+    if (view.getUint8(0) >> 4 > FRAME_VERSION) return null;
+    const size = view.byteLength;
+    const bytes = new Uint8Array(view.buffer, view.byteOffset, size);
+    if (frameCrc16(bytes, size - 2) !== view.getUint16(size - 2, true)) return null;
+
+    return {
+        op: view.getUint8(1) & ~CMD_RESPONSE_BIT,
+        seq: view.getUint8(2),
+        status: view.getUint8(3),
+        payload: new DataView(view.buffer, view.byteOffset + 4, size - 6),
+    };
+}
+
+// CMD_GET_CONFIG / SET / RESET payload: u8 schema, then {u8 key, i32 value}
+export function decodeConfig(payload: DataView): Partial<Record<ConfigKey, number>> {
+    const names = Object.fromEntries(Object.entries(CONFIG_KEYS).map(([k, v]) => [v, k as ConfigKey]));
+    const config: Partial<Record<ConfigKey, number>> = {};
+    for (let i = 1; i + 5 <= payload.byteLength; i += 5) {
+        const name = names[payload.getUint8(i)];
+        if (name) config[name] = payload.getInt32(i + 1, true);
+    }
+    return config;
+}
+
+// CMD_LIST_RECORDINGS payload
+export function decodeRecordingList(payload: DataView): { total: number; first: number; entries: RecordingEntry[] } {
+    const total = payload.getUint16(0, true);
+    const first = payload.getUint16(2, true);
+    const count = payload.getUint8(4);
+    const entries: RecordingEntry[] = [];
+    let offset = 5;
+    for (let i = 0; i < count && offset + 5 <= payload.byteLength; i++) {
+        const size = payload.getUint32(offset, true);
+        const len = payload.getUint8(offset + 4);
+        const name = String.fromCharCode(...new Uint8Array(payload.buffer, payload.byteOffset + offset + 5, len));
+        entries.push({ name, size });
+        offset += 5 + len;
+    }
+    return { total, first, entries };
+}